@@ -42,8 +42,8 @@ void imageToPng(const gg::Image& img, const std::string& destFile,
 	assert(pal);
 
 	auto dims = img.dimensions();
-	auto data = img.convert();
-	auto mask = img.convert_mask();
+	gg::Pixels data, mask;
+	img.convertBoth(data, mask);
 
 	png::image<png::index_pixel> png(dims.x, dims.y);
 
@@ -181,7 +181,7 @@ void pngToImage(gg::Image* img, const std::string& srcFile)
 		}
 		img->palette(newPal);
 	}
-	img->convert(pix, mask);
+	img->convert(std::move(pix), std::move(mask));
 	return;
 }
 
@@ -194,8 +194,8 @@ void pngToImage(gg::Image* img, const std::string& srcFile)
 void imageToANSI(const gg::Image& img)
 {
 	auto dims = img.dimensions();
-	auto data = img.convert();
-	auto mask = img.convert_mask();
+	gg::Pixels data, mask;
+	img.convertBoth(data, mask);
 
 	int pos = 0;
 	bool bright = false, xp = false;
@@ -267,8 +267,8 @@ rewrite_png:
 		if (i->fAttr & gg::Tileset::File::Attribute::Folder) continue; // aah! tileset! bad!
 
 		auto img = tileset->openImage(i);
-		auto data = img->convert();
-		auto mask = img->convert_mask();
+		gg::Pixels data, mask;
+		img->convertBoth(data, mask);
 
 		unsigned int offX = (t % widthTiles) * dims.x;
 		unsigned int offY = (t / widthTiles) * dims.y;
@@ -0,0 +1,101 @@
+/**
+ * @file  camoto/gamegraphics/executor.hpp
+ * @brief Interface for running conversions in the background.
+ *
+ * Copyright (C) 2010-2017 Adam Nielsen <malvineous@shikadi.net>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CAMOTO_GAMEGRAPHICS_EXECUTOR_HPP_
+#define _CAMOTO_GAMEGRAPHICS_EXECUTOR_HPP_
+
+#include <functional>
+#include <future>
+#include <memory>
+#include <camoto/config.hpp>
+
+namespace camoto {
+namespace gamegraphics {
+
+/// Something that can run tasks, such as a thread pool.
+/**
+ * The library never creates threads of its own.  Functions such as
+ * Image::convertAsync() instead hand their work to an Executor supplied by
+ * the caller, which decides where and when it runs.
+ *
+ * Each task is an ordinary synchronous call, which seeks and reads the shared
+ * underlying stream like any other.  Tasks for the same tileset, or for images
+ * that share a stream, must therefore not overlap: submit them to an executor
+ * that runs them one at a time (such as a single worker thread), and use a
+ * different executor for each file that is to be read in parallel.
+ */
+class CAMOTO_GAMEGRAPHICS_API Executor
+{
+	public:
+		virtual ~Executor();
+
+		/// Run a task.
+		/**
+		 * The task may be run on any thread, at any later time, or immediately
+		 * before this function returns.  It must be run exactly once.
+		 *
+		 * @param task
+		 *   Function to run.  It does not throw, as any exceptions are passed
+		 *   back through the future returned to the original caller.
+		 */
+		virtual void submit(std::function<void()> task) = 0;
+};
+
+/// Executor that runs each task immediately, on the calling thread.
+/**
+ * This is useful when an asynchronous interface is required but there is no
+ * benefit in running the work elsewhere.
+ */
+class CAMOTO_GAMEGRAPHICS_API ImmediateExecutor: public Executor
+{
+	public:
+		virtual ~ImmediateExecutor();
+
+		virtual void submit(std::function<void()> task);
+};
+
+/// Run a function on an executor and return a future for its result.
+/**
+ * @param exec
+ *   Executor to run the function on.
+ *
+ * @param fn
+ *   Function to run.  If it throws an exception, the exception is rethrown
+ *   when the future's get() is called.
+ *
+ * @return Future that becomes ready when fn has completed.
+ */
+template <class T, class F>
+std::future<T> submitTask(Executor& exec, F fn)
+{
+	// std::function must be copyable, so the task is shared rather than moved
+	// into it.
+	auto task = std::make_shared<std::packaged_task<T()>>(std::move(fn));
+	auto result = task->get_future();
+	exec.submit([task]() {
+		(*task)();
+	});
+	return result;
+}
+
+} // namespace gamegraphics
+} // namespace camoto
+
+#endif // _CAMOTO_GAMEGRAPHICS_EXECUTOR_HPP_
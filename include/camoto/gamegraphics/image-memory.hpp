@@ -53,6 +53,25 @@ class CAMOTO_GAMEGRAPHICS_API Image_Memory: public Image
 		Image_Memory(const Point& dims, const Pixels& pixels, const Pixels& mask,
 			const Point& hotspot, const Point& hitrect,
 			std::shared_ptr<const Palette> pal);
+
+		/// Create an image that takes ownership of the supplied buffers.
+		/**
+		 * This is the same as the other constructor, except the pixel and mask
+		 * buffers are moved into the image rather than copied.
+		 */
+		Image_Memory(const Point& dims, Pixels&& pixels, Pixels&& mask,
+			const Point& hotspot, const Point& hitrect,
+			std::shared_ptr<const Palette> pal);
+
+		/// Create an image that shares the supplied buffers.
+		/**
+		 * This is the same as the other constructors, except the image refers to
+		 * the same pixel and mask data as the caller.  The data is only copied if
+		 * either side later modifies it.
+		 */
+		Image_Memory(const Point& dims, SharedPixels pixels, SharedPixels mask,
+			const Point& hotspot, const Point& hitrect,
+			std::shared_ptr<const Palette> pal);
 		virtual ~Image_Memory();
 
 		virtual Caps caps() const;
@@ -60,17 +79,29 @@ class CAMOTO_GAMEGRAPHICS_API Image_Memory: public Image
 		virtual Point dimensions() const;
 		virtual Point hotspot() const;
 		virtual Point hitrect() const;
+		virtual MaskKind maskKind() const;
+		using Image::convert;
 		virtual Pixels convert() const;
 		virtual Pixels convert_mask() const;
+		virtual SharedPixels convertShared() const;
+		virtual void convertBothShared(SharedPixels& pixels, SharedPixels& mask)
+			const;
 		virtual void convert(const Pixels& newContent,
 			const Pixels& newMask);
+		virtual void convert(Pixels&& newContent, Pixels&& newMask);
+		virtual void convertInto(uint8_t *pixels, uint8_t *mask, size_t stride)
+			const;
 
 	protected:
+		/// Work out maskKind() from the current mask data.
+		void updateMaskKind();
+
 		Point dims;
-		Pixels pixels;
-		Pixels mask;
+		SharedPixels pixels;
+		SharedPixels mask;
 		Point ptHotspot;
 		Point ptHitrect;
+		MaskKind kind; ///< Mask bits used by the current mask data
 };
 
 } // namespace gamegraphics
@@ -23,18 +23,112 @@
 #ifndef _CAMOTO_GAMEGRAPHICS_IMAGE_HPP_
 #define _CAMOTO_GAMEGRAPHICS_IMAGE_HPP_
 
+#include <functional>
 #include <memory>
 #include <cstdint>
 #include <camoto/config.hpp>
 #include <camoto/stream.hpp> // for stream::error
+#include <camoto/gamegraphics/executor.hpp>
 #include <camoto/gamegraphics/palette.hpp>
+#include <camoto/gamegraphics/pixel-arena.hpp>
 
 namespace camoto {
 namespace gamegraphics {
 
-/// Shared pointer to the raw image data
+/// Raw image data.
+/**
+ * This always uses the heap, so it can be kept for as long as needed.  See
+ * ArenaPixels for temporary buffers that can come from a PixelArena.
+ */
 typedef std::vector<uint8_t> Pixels;
 
+/// Reference-counted pixel buffer that is copied when modified.
+/**
+ * Copying a SharedPixels only copies a reference to the underlying buffer,
+ * so an image can hand out its decoded data (see Image::convertShared())
+ * without duplicating it.  The buffer is only duplicated when mutate() is
+ * called while another SharedPixels still refers to it, so any changes are
+ * never seen by the other holders.
+ *
+ * Different threads may hold copies of the same SharedPixels, but any single
+ * instance must only be used by one thread at a time.
+ */
+class SharedPixels
+{
+	public:
+		/// Create an empty buffer.
+		SharedPixels()
+			:	buf(std::make_shared<Pixels>())
+		{
+		}
+
+		/// Take ownership of existing pixel data.
+		explicit SharedPixels(Pixels data)
+			:	buf(std::make_shared<Pixels>(std::move(data)))
+		{
+		}
+
+		/// Read-only access to the pixel data.
+		const Pixels& operator*() const
+		{
+			return *this->buf;
+		}
+
+		/// Read-only access to the pixel data.
+		const Pixels* operator->() const
+		{
+			return this->buf.get();
+		}
+
+		const uint8_t *data() const
+		{
+			return this->buf->data();
+		}
+
+		size_t size() const
+		{
+			return this->buf->size();
+		}
+
+		bool empty() const
+		{
+			return this->buf->empty();
+		}
+
+		/// Is the buffer also referred to by another SharedPixels?
+		bool shared() const
+		{
+			return this->buf.use_count() > 1;
+		}
+
+		/// Get write access to the pixel data.
+		/**
+		 * If the buffer is shared, it is copied first so this instance has its
+		 * own copy to modify.  The returned reference is only valid until this
+		 * instance is next assigned to.
+		 */
+		Pixels& mutate()
+		{
+			if (this->shared()) this->buf = std::make_shared<Pixels>(*this->buf);
+			return *this->buf;
+		}
+
+		/// Take the pixel data out of the buffer.
+		/**
+		 * The data is moved out if nothing else refers to it, otherwise it is
+		 * copied.  The buffer is left empty.
+		 */
+		Pixels release()
+		{
+			Pixels data = this->shared() ? *this->buf : std::move(*this->buf);
+			this->buf = std::make_shared<Pixels>();
+			return data;
+		}
+
+	protected:
+		std::shared_ptr<Pixels> buf; ///< Pixel data, possibly shared
+};
+
 struct Point
 {
 	long x;
@@ -57,6 +151,49 @@ struct Rect
 	long height; ///< Height of rectangle
 };
 
+/// One bit per pixel collision map, as returned by Image::hitBitmap().
+/**
+ * Each row is stored in whole 64-bit words, so two bitmaps can be tested
+ * against each other 64 pixels at a time (see hitTest() in util.hpp.)  The
+ * leftmost pixel of each word is in its most significant bit, and unused bits
+ * at the end of each row are zero.
+ */
+struct HitBitmap
+{
+	Point dims;                 ///< Size of the bitmap, in pixels
+	size_t stride;              ///< Number of words in each row
+	std::vector<uint64_t> bits; ///< Bitmap data, stride * dims.y words long
+
+	/// Is the given pixel solid?
+	/**
+	 * @param x
+	 *   X coordinate, must be less than dims.x.
+	 *
+	 * @param y
+	 *   Y coordinate, must be less than dims.y.
+	 */
+	bool test(long x, long y) const
+	{
+		return (this->bits[y * this->stride + x / 64] >> (63 - x % 64)) & 1;
+	}
+};
+
+/// Callback function for Image::decodeRows().
+/**
+ * @param y
+ *   Row number, starting at 0 for the top of the image.
+ *
+ * @param rowPixels
+ *   Pixel data for this row, in the same format as returned by
+ *   Image::convert().  Only valid until the callback returns.
+ *
+ * @param rowMask
+ *   Mask data for this row, in the same format as returned by
+ *   Image::convert_mask().  Only valid until the callback returns.
+ */
+typedef std::function<void(long y, const uint8_t *rowPixels,
+	const uint8_t *rowMask)> fn_image_row;
+
 enum class ColourDepth
 {
 	Mono, ///< Set if the image is 1bpp (black and white)
@@ -65,6 +202,17 @@ enum class ColourDepth
 	VGA,  ///< Set if the image is 8bpp (256 colour)
 };
 
+/// Get the number of bits used to store one pixel at the given colour depth.
+/**
+ * @param depth
+ *   Colour depth, as returned by Image::colourDepth().
+ *
+ * @return 1, 2, 4 or 8.
+ */
+CAMOTO_GAMEGRAPHICS_API unsigned int bitsPerPixel(ColourDepth depth);
+
+struct ImageSnapshot;
+
 /// Primary interface to an image file.
 /**
  * This class represents a single image.  Its functions are used to convert
@@ -76,7 +224,9 @@ enum class ColourDepth
  *
  * @note Multithreading: Only call one function in this class at a time.  Many
  *       of the functions seek around the underlying stream and thus will break
- *       if two or more functions are executing at the same time.
+ *       if two or more functions are executing at the same time.  Use
+ *       snapshot() to get a copy of the decoded image that can be shared
+ *       between threads.
  */
 class CAMOTO_GAMEGRAPHICS_API Image
 {
@@ -108,6 +258,18 @@ class CAMOTO_GAMEGRAPHICS_API Image
 			Touch       = 0x02, ///< Mask: 0=pass, 1=hit
 		};
 
+		/// Which bits of the mask an image is able to set.
+		/**
+		 * The values match those in \ref Mask, so a mask byte can only have bits
+		 * set that are also set in the image's MaskKind.
+		 */
+		enum class MaskKind : uint8_t {
+			Opaque      = 0x00, ///< No mask, every pixel is opaque and never hit
+			Transparent = 0x01, ///< Pixels may be transparent
+			Touch       = 0x02, ///< Pixels may be hit
+			Both        = 0x03, ///< Pixels may be transparent and/or hit
+		};
+
 		Image();
 		virtual ~Image();
 
@@ -208,9 +370,12 @@ class CAMOTO_GAMEGRAPHICS_API Image
 		 * This function converts whatever the underlying image format is into
 		 * 8bpp indexed data.
 		 *
+		 * The default implementation allocates a buffer and fills it with
+		 * convertInto().
+		 *
 		 * @return A shared pointer to a byte array of image data.
 		 */
-		virtual Pixels convert() const = 0;
+		virtual Pixels convert() const;
 
 		/// Convert the image mask into a standard format.
 		/**
@@ -223,9 +388,413 @@ class CAMOTO_GAMEGRAPHICS_API Image
 		 * Mask_Vis_Transparent) and the next bit (Mask_Hitmap)
 		 * is used to denote hitmapping (Mask_Hit_Touch or Mask_Hit_Pass)
 		 *
+		 * The default implementation allocates a buffer and fills it with
+		 * convertInto(), or just clears it if hasMask() returns false.
+		 *
 		 * @return A shared pointer to a byte array of mask data.
 		 */
-		virtual Pixels convert_mask() const = 0;
+		virtual Pixels convert_mask() const;
+
+		/// Find out what the image mask can contain.
+		/**
+		 * Formats that have no way of storing transparency or hitmap data return
+		 * MaskKind::Opaque, in which case the mask is always zero and callers can
+		 * skip any mask processing.
+		 *
+		 * For file formats this depends only on the format, not the image
+		 * content, so an image that could have transparent pixels but doesn't
+		 * will still report MaskKind::Transparent.  Images held in memory, which
+		 * can store any mask, report only the bits their mask actually uses.
+		 *
+		 * The default implementation returns MaskKind::Both.
+		 */
+		virtual MaskKind maskKind() const;
+
+		/// Can any pixel in the image be transparent or hit?
+		/**
+		 * @return false if maskKind() is MaskKind::Opaque, true otherwise.
+		 */
+		bool hasMask() const;
+
+		/// Convert the image mask into a standard format, without copying it.
+		/**
+		 * This is the same as convert_mask(), but if hasMask() returns false
+		 * the mask is not generated at all.  Instead a zeroed buffer shared by
+		 * all opaque images of the same size is returned.
+		 *
+		 * @return Mask data.  Call SharedPixels::mutate() before modifying it.
+		 */
+		virtual SharedPixels convertMaskShared() const;
+
+		/// Get an all-opaque mask, shared between callers.
+		/**
+		 * Each thread keeps the last buffer it returned, and hands it out again
+		 * for the next request of the same size, so a run of images of the same
+		 * size (such as the tiles in a tileset) only costs a reference count
+		 * increment after the first one.  No locks are taken, and only one buffer
+		 * per thread is kept once the callers have released theirs.
+		 *
+		 * @param dims
+		 *   Image dimensions, in pixels.
+		 *
+		 * @return Zeroed mask data, dims.x * dims.y bytes long.
+		 */
+		static SharedPixels opaqueMask(const Point& dims);
+
+		/// Convert part of the image into a standard format.
+		/**
+		 * This is the same as convert(), but only the pixels within the given
+		 * rectangle are returned.  Formats that can locate a given row or column
+		 * without decoding the whole image will only read the data needed, so
+		 * this is much faster than convert() when only a small part of a large
+		 * image is required, such as a single tile out of a tilesheet.
+		 *
+		 * The default implementation converts the whole image and returns the
+		 * requested portion.
+		 *
+		 * @param region
+		 *   Area to convert.  Must lie entirely within the image dimensions.
+		 *
+		 * @return 8bpp indexed pixel data, region.width * region.height bytes
+		 *   long, with the pixel at (region.x, region.y) first.
+		 *
+		 * @throw stream::error if the region does not fit within the image, or
+		 *   on I/O error.
+		 */
+		virtual Pixels convert(const Rect& region) const;
+
+		/// Convert the image into a standard format at a reduced size.
+		/**
+		 * Only every 2^shift-th pixel of every 2^shift-th row is returned,
+		 * starting with the top-left pixel.  The pixels are sampled rather than
+		 * averaged, so no new colours are introduced.  This is intended for
+		 * thumbnails, and formats that can skip over rows and columns without
+		 * decoding them do so.
+		 *
+		 * The default implementation runs through every row with decodeRows()
+		 * and keeps only the pixels that are needed.
+		 *
+		 * @param shift
+		 *   Scale to reduce the image by, as a power of two.  0 returns the full
+		 *   size image, 1 half size, 2 quarter size and 3 eighth size.
+		 *
+		 * @return 8bpp indexed pixel data, with the size given by
+		 *   previewDimensions().
+		 */
+		virtual Pixels convertPreview(unsigned int shift) const;
+
+		/// Get the size of the image returned by convertPreview().
+		/**
+		 * @param shift
+		 *   Same value passed to convertPreview().
+		 *
+		 * @return Image dimensions divided by 2^shift, rounded up so that a
+		 *   partial block of pixels at the right or bottom edge is included.
+		 */
+		Point previewDimensions(unsigned int shift) const;
+
+		/// Convert the image and its mask in a single pass.
+		/**
+		 * This returns the same data as calling convert() followed by
+		 * convert_mask(), but masked formats store the mask interleaved with the
+		 * pixel data, so decoding both at once avoids reading and parsing the
+		 * underlying data twice.
+		 *
+		 * @param pixels
+		 *   On return, contains the same data as convert() would return.  Any
+		 *   existing content is replaced.
+		 *
+		 * @param mask
+		 *   On return, contains the same data as convert_mask() would return.  Any
+		 *   existing content is replaced.
+		 *
+		 * @throw stream::error on I/O error.
+		 */
+		virtual void convertBoth(Pixels& pixels, Pixels& mask) const;
+
+		/// Convert the image into a standard format, without copying it.
+		/**
+		 * This returns the same data as convert(), but formats that keep a
+		 * decoded copy of the image in memory return a reference to it rather
+		 * than a copy.  Reading an unchanged image again is then little more than
+		 * a reference count increment, which helps callers that convert the same
+		 * image repeatedly, such as when redrawing it on screen.
+		 *
+		 * The default implementation wraps the result of convert().
+		 *
+		 * @return 8bpp indexed pixel data.  Call SharedPixels::mutate() before
+		 *   modifying it, which will copy the data if the image is still using
+		 *   it.
+		 */
+		virtual SharedPixels convertShared() const;
+
+		/// Convert the image and mask into a standard format, without copying.
+		/**
+		 * This is the same as convertShared(), but returns the mask as well, in
+		 * the same way as convertBoth().
+		 *
+		 * The default implementation wraps the result of convertBoth(), or
+		 * convertShared() and opaqueMask() if hasMask() returns false.
+		 *
+		 * @param pixels
+		 *   On return, the 8bpp indexed pixel data.
+		 *
+		 * @param mask
+		 *   On return, the mask data.
+		 */
+		virtual void convertBothShared(SharedPixels& pixels, SharedPixels& mask)
+			const;
+
+		/// Decode the image one row at a time.
+		/**
+		 * Each row of the image is decoded in turn, from top to bottom, and
+		 * passed to the callback before the next row is decoded.  Formats that
+		 * can decode incrementally only ever hold a single row in memory, so this
+		 * allows large images to be processed (e.g. written out to another file
+		 * format) in constant memory.
+		 *
+		 * The default implementation calls convertBoth() and then passes each row
+		 * of the result to the callback.
+		 *
+		 * @param fnRow
+		 *   Function to call for each row.  It is called exactly once for each row
+		 *   in the image, in order.
+		 *
+		 * @throw stream::error on I/O error.  Rows already passed to the callback
+		 *   are not revisited.
+		 */
+		virtual void decodeRows(fn_image_row fnRow) const;
+
+		/// Convert the image into packed pixels at its native colour depth.
+		/**
+		 * This returns the same pixel values as convert(), but instead of using a
+		 * whole byte for every pixel, only bitsPerPixel(colourDepth()) bits are
+		 * used.  Each byte holds the leftmost pixel in its most significant bits,
+		 * and each row starts on a byte boundary, so a row is
+		 * (dimensions().x * bitsPerPixel(colourDepth()) + 7) / 8 bytes long.
+		 * For 16-colour images this halves the memory needed to keep the decoded
+		 * image around, and for monochrome images it is one eighth.
+		 *
+		 * VGA images are returned unchanged, as they already use one byte per
+		 * pixel.
+		 *
+		 * The default implementation packs each row as it is returned by
+		 * decodeRows(), so the full 8bpp image is never held in memory for
+		 * formats that can decode one row at a time.
+		 *
+		 * @return Packed pixel data.  The mask is not included.
+		 *
+		 * @throw stream::error on I/O error.
+		 */
+		virtual Pixels convertPacked() const;
+
+		/// Convert the image mask into packed 1bpp planes.
+		/**
+		 * This returns the same information as convert_mask(), but split into two
+		 * separate planes of one bit per pixel, one for each of the \ref Mask
+		 * bits.  The layout matches convertPacked() for a monochrome image: the
+		 * leftmost pixel is in the most significant bit of each byte, and each
+		 * row is padded to a whole byte, making it (dimensions().x + 7) / 8 bytes
+		 * long.  Unused bits at the end of each row are zero.
+		 *
+		 * Formats that store their mask as separate bit planes can return them
+		 * directly, without expanding them to a byte per pixel first.
+		 *
+		 * The default implementation packs each row of the mask as it is
+		 * returned by decodeRows(), or returns empty planes without decoding
+		 * anything if hasMask() returns false.
+		 *
+		 * @param transparent
+		 *   On return, contains one bit per pixel, set where the pixel has
+		 *   Mask::Transparent set.  Any existing content is replaced.
+		 *
+		 * @param touch
+		 *   On return, contains one bit per pixel, set where the pixel has
+		 *   Mask::Touch set.  Any existing content is replaced.
+		 *
+		 * @throw stream::error on I/O error.
+		 */
+		virtual void convertMaskPacked(Pixels& transparent, Pixels& touch) const;
+
+		/// Get a packed collision map of the image.
+		/**
+		 * Pixels with Mask::Touch set are solid.  If maskKind() says the image
+		 * can't store hitmap data, then every pixel that is not transparent is
+		 * solid instead, which is what games without a separate hitmap use.
+		 *
+		 * The default implementation builds the bitmap from convertMaskPacked(),
+		 * so formats that store their mask as bit planes provide the data
+		 * without the mask ever being expanded to a byte per pixel.
+		 *
+		 * @return Collision bitmap, the same size as the image.
+		 *
+		 * @throw stream::error on I/O error.
+		 */
+		virtual HitBitmap hitBitmap() const;
+
+		/// Find the smallest rectangle containing every visible pixel.
+		/**
+		 * Sprites are often stored with a transparent border, which costs time
+		 * every time they are drawn and wastes space when they are packed into a
+		 * texture atlas.  This finds the area that is left once that border has
+		 * been removed (see trimImage() in util.hpp.)
+		 *
+		 * The default implementation scans the transparency plane from
+		 * convertMaskPacked(), 64 pixels at a time, so formats that store
+		 * their mask as bit planes never expand it to a byte per pixel.  If
+		 * maskKind() says the image can't have transparent pixels, the full image
+		 * is returned without reading anything.
+		 *
+		 * @return Area of the image containing all the pixels without
+		 *   Mask::Transparent set.  If every pixel is transparent, the width and
+		 *   height are both zero.
+		 *
+		 * @throw stream::error on I/O error.
+		 */
+		virtual Rect opaqueBounds() const;
+
+		/// Convert the image into 32-bit RGBA, ready for display.
+		/**
+		 * The palette is applied to each pixel, and pixels with
+		 * Mask::Transparent set are returned as transparent black.  This is
+		 * faster than looking up each pixel from convert() separately, as the
+		 * palette is applied several pixels at a time where the processor
+		 * supports it.
+		 *
+		 * The default implementation expands each row as it is returned by
+		 * decodeRows(), so formats that decode one row at a time never hold the
+		 * full 8bpp image in memory.
+		 *
+		 * @param palette
+		 *   Palette to apply.  Normally palette(), or a default palette matching
+		 *   colourDepth() if the image has none.  Pixel values beyond the end of
+		 *   the palette are returned as transparent black.
+		 *
+		 * @return Four bytes per pixel, in the order red, green, blue, alpha,
+		 *   with no padding between rows.  The alpha value comes from the
+		 *   palette entry.
+		 *
+		 * @throw stream::error on I/O error.
+		 */
+		virtual Pixels convertRGBA(const Palette& palette) const;
+
+		/// Decode the image into an immutable copy that is safe to share.
+		/**
+		 * The returned snapshot holds everything needed to draw the image, all
+		 * decoded up front.  Unlike the Image itself, it never touches the
+		 * underlying stream, so any number of threads may read the same
+		 * snapshot at the same time without locking.
+		 *
+		 * The snapshot is not updated if the image is later changed, so a new
+		 * one must be taken after each change.
+		 *
+		 * The default implementation fills the snapshot using convertBoth(),
+		 * along with hotspot(), hitrect() and palette() where caps() reports
+		 * they are available.
+		 *
+		 * @return Shared pointer to the snapshot.
+		 *
+		 * @throw stream::error on I/O error.
+		 */
+		virtual std::shared_ptr<const ImageSnapshot> snapshot() const;
+
+		/// Get a 64-bit hash of the image content.
+		/**
+		 * This is used to find duplicate images and as a cache key.  Two images
+		 * with the same hash almost certainly have the same content.
+		 *
+		 * The default implementation hashes the decoded image: the dimensions,
+		 * then each row of pixels followed by the same row of the mask.  Formats
+		 * with a fixed layout hash their stored bytes (and the dimensions)
+		 * instead, which is much faster as nothing has to be decoded.  As a
+		 * result hashes can only be compared between images of the same format,
+		 * and each format documents which of the two it uses.
+		 *
+		 * The palette is not included in the hash.
+		 *
+		 * @return Hash value.
+		 *
+		 * @throw stream::error on I/O error.
+		 */
+		virtual uint64_t contentHash() const;
+
+		/// Is every pixel in the image the same?
+		/**
+		 * This is used to skip or collapse blank and single-colour tiles without
+		 * having to decode them.  The image only counts as uniform if every pixel
+		 * has the same colour and the same mask value.
+		 *
+		 * The default implementation decodes the image and compares the pixels.
+		 * Formats with a fixed layout check the stored bytes instead.
+		 *
+		 * @param colour
+		 *   If not nullptr and the image is uniform, set to the colour of every
+		 *   pixel.
+		 *
+		 * @param mask
+		 *   If not nullptr and the image is uniform, set to the mask value of
+		 *   every pixel.
+		 *
+		 * @return true if the image is uniform, false if the pixels differ or the
+		 *   image has no pixels at all.
+		 *
+		 * @throw stream::error on I/O error.
+		 */
+		virtual bool isUniform(uint8_t *colour, uint8_t *mask = nullptr) const;
+
+		/// Convert the image into a standard format in the background.
+		/**
+		 * This is the same as convert(), but the work is handed to the given
+		 * executor, leaving the calling thread free to do something else (such as
+		 * reading the next file) in the meantime.
+		 *
+		 * This does not give the conversion a stream position of its own, so the
+		 * usual multithreading rule still applies: until the returned future is
+		 * ready, no other function may be called on this image, or on any other
+		 * image sharing the same underlying stream (such as another tile from the
+		 * same tileset), except to queue further async calls on an executor that
+		 * runs them one at a time.  Use snapshot() to share decoded images
+		 * between threads.
+		 *
+		 * The default implementation runs convert() on the executor.
+		 *
+		 * @param exec
+		 *   Executor to run the conversion on.  The image must remain valid until
+		 *   the conversion has finished.
+		 *
+		 * @return Future for the same data convert() would return.  Any
+		 *   exception thrown during the conversion is rethrown by its get()
+		 *   function.
+		 */
+		virtual std::future<Pixels> convertAsync(Executor& exec) const;
+
+		/// Convert the image and/or mask into caller-supplied buffers.
+		/**
+		 * This is the same as convert() and convert_mask(), except the data is
+		 * written directly into memory owned by the caller, such as a region of a
+		 * larger texture atlas.  This avoids allocating and copying a new buffer
+		 * for every image.
+		 *
+		 * Row y of the image is written to the dimensions().x bytes beginning at
+		 * offset y * stride.  Any bytes between the end of one row and the start
+		 * of the next are left untouched.
+		 *
+		 * @param pixels
+		 *   Destination for the 8bpp indexed image data, in the same format as
+		 *   returned by convert().  May be nullptr if only the mask is needed.
+		 *
+		 * @param mask
+		 *   Destination for the mask data, in the same format as returned by
+		 *   convert_mask().  May be nullptr if only the pixels are needed.
+		 *
+		 * @param stride
+		 *   Number of bytes from the start of one row to the start of the next.
+		 *   Must be at least dimensions().x.
+		 *
+		 * @throw stream::error on I/O error.
+		 */
+		virtual void convertInto(uint8_t *pixels, uint8_t *mask, size_t stride)
+			const = 0;
 
 		/// Replace the image with new content.
 		/**
@@ -252,6 +821,150 @@ class CAMOTO_GAMEGRAPHICS_API Image
 		virtual void convert(const Pixels& newContent,
 			const Pixels& newMask) = 0;
 
+		/// Replace the image with new content, taking ownership of the buffers.
+		/**
+		 * This is the same as convert(const Pixels&, const Pixels&), except the
+		 * buffers are moved into the image where possible rather than copied.
+		 * This is useful for images held in memory, which can keep the supplied
+		 * buffers as-is.  The buffers are left in a valid but unspecified state.
+		 *
+		 * The default implementation calls the const version, so formats that
+		 * have to convert the data anyway need not override this.
+		 *
+		 * @param newContent
+		 *   Image data, in the standard 8bpp indexed format.
+		 *
+		 * @param newMask
+		 *   Mask data, in the standard 8bpp format.
+		 */
+		virtual void convert(Pixels&& newContent, Pixels&& newMask);
+
+		/// Replace part of the image with new content.
+		/**
+		 * This is the same as convert(const Pixels&, const Pixels&), except only
+		 * the pixels within the given rectangle are replaced and the rest of the
+		 * image is left as-is.  Formats with a fixed layout overwrite only the
+		 * bytes covering the region, and formats that compress each row
+		 * separately only re-encode the affected rows, so this is much faster
+		 * than replacing the whole image when only a few pixels have changed.
+		 *
+		 * The default implementation converts the whole image, copies in the new
+		 * pixels and writes the whole image back.
+		 *
+		 * @param region
+		 *   Area to replace.  Must lie entirely within the image dimensions.
+		 *
+		 * @param newContent
+		 *   Image data, in the standard 8bpp indexed format,
+		 *   region.width * region.height bytes long.
+		 *
+		 * @param newMask
+		 *   Mask data, in the standard 8bpp format, the same size as newContent.
+		 *
+		 * @throw stream::error if the region does not fit within the image, or
+		 *   on I/O error.
+		 */
+		virtual void convert(const Rect& region, const Pixels& newContent,
+			const Pixels& newMask);
+
+		/// Work out how large the image would be if it were replaced.
+		/**
+		 * This returns the size the underlying stream would have after passing
+		 * the same parameters to convert(const Pixels&, const Pixels&), without
+		 * writing anything to it.  It can be used to pick between formats or to
+		 * allocate space for the image in advance.
+		 *
+		 * Formats with a fixed layout calculate the size from the dimensions
+		 * alone.  Compressed formats run the compressor over the data, but only
+		 * count the bytes it produces.
+		 *
+		 * The default implementation throws an exception, as the size can only
+		 * be found by encoding the image.
+		 *
+		 * @param newContent
+		 *   Image data, in the standard 8bpp indexed format.
+		 *
+		 * @param newMask
+		 *   Mask data, in the standard 8bpp format.
+		 *
+		 * @return Size of the encoded image, in bytes, including any headers.
+		 *
+		 * @throw stream::error if this format cannot calculate the size.
+		 *
+		 * @note As with convert(), the size is calculated for the image's current
+		 *   dimensions, so these must be set first.
+		 */
+		virtual stream::len encodedSize(const Pixels& newContent,
+			const Pixels& newMask) const;
+
+		/// Mirror the image horizontally, swapping the left and right edges.
+		/**
+		 * The image data and mask are both flipped, and the result is written
+		 * back to the underlying format.
+		 *
+		 * The default implementation decodes the whole image, flips it and
+		 * writes it back with convert().  Formats that can rearrange their
+		 * native data directly override this to avoid the conversion.
+		 */
+		virtual void flipH();
+
+		/// Mirror the image vertically, swapping the top and bottom edges.
+		/**
+		 * Like flipH(), the default implementation goes through convert().
+		 */
+		virtual void flipV();
+
+		/// Rotate the image 90 degrees clockwise.
+		/**
+		 * The width and height are swapped, so unless the image is square
+		 * caps() must include SetDimensions.
+		 *
+		 * @throw stream::error if the image is not square and its dimensions
+		 *   cannot be changed.
+		 */
+		virtual void rotate90();
+
+		/// Discard everything outside the given area.
+		/**
+		 * @param region
+		 *   Area to keep, which becomes the whole image.  Must lie entirely
+		 *   within the image dimensions.  Unless it is the same size as the
+		 *   image, caps() must include SetDimensions.
+		 *
+		 * @throw stream::error if the region is outside the image, or if the
+		 *   image size would change and the dimensions cannot be changed.
+		 */
+		virtual void crop(const Rect& region);
+
+		/// Release any decoded image data held in memory.
+		/**
+		 * Some formats keep a decoded copy of the image after the first call to
+		 * convert(), to speed up later calls.  This function frees that copy.
+		 * It should also be called if the underlying data has been modified by
+		 * some means other than this Image instance, so the changes are picked
+		 * up on the next call to convert().
+		 *
+		 * The default implementation does nothing, as most formats do not keep
+		 * a cache.
+		 */
+		virtual void dropCache();
+
+		/// Choose whether decoded image data is kept in memory.
+		/**
+		 * Formats that keep a decoded copy of the image (see dropCache()) do so
+		 * by default.  When the image will only be converted once, such as when
+		 * exporting a large number of tiles, the cache can be switched off so
+		 * that each image does not keep its decoded copy alive afterwards.
+		 *
+		 * The default implementation does nothing.
+		 *
+		 * @param keep
+		 *   true to cache decoded data (the default), false to decode the image
+		 *   from scratch every time.  Setting this to false also releases any
+		 *   data already cached.
+		 */
+		virtual void cacheDecoded(bool keep);
+
 		/// Get the indexed colour map from the file.
 		/**
 		 * @pre caps() return value includes HasPalette.
@@ -270,9 +983,196 @@ class CAMOTO_GAMEGRAPHICS_API Image
 		virtual void palette(std::shared_ptr<const Palette> newPalette);
 
 	protected:
+		/// Ensure a region passed to convert() is within the image.
+		/**
+		 * @throw stream::error if any part of the region lies outside the image.
+		 */
+		void checkRegion(const Rect& region) const;
+
+		/// Copy tightly packed image data into a buffer with the given stride.
+		/**
+		 * Helper function for convertInto() implementations that already have
+		 * the image data in memory.
+		 *
+		 * @param dst
+		 *   Destination buffer, as passed to convertInto().
+		 *
+		 * @param stride
+		 *   Distance between rows in dst, in bytes.
+		 *
+		 * @param dims
+		 *   Image dimensions.
+		 *
+		 * @param src
+		 *   Source data, dims.x * dims.y bytes long.
+		 */
+		static void copyRows(uint8_t *dst, size_t stride, const Point& dims,
+			const uint8_t *src);
+
+		/// Set every pixel in a buffer with the given stride to the same value.
+		/**
+		 * Helper function for convertInto() implementations, typically used to
+		 * return an entirely opaque mask.
+		 *
+		 * @param dst
+		 *   Destination buffer, as passed to convertInto().
+		 *
+		 * @param stride
+		 *   Distance between rows in dst, in bytes.
+		 *
+		 * @param dims
+		 *   Image dimensions.
+		 *
+		 * @param value
+		 *   Value to write to every pixel.
+		 */
+		static void fillRows(uint8_t *dst, size_t stride, const Point& dims,
+			uint8_t value);
+
+		/// Find which mask bits are actually used in some mask data.
+		/**
+		 * Helper function for maskKind() implementations that hold their mask
+		 * in memory, and so can report exactly what it contains.
+		 *
+		 * @param mask
+		 *   Mask data, in the same format as convert_mask().
+		 *
+		 * @param stride
+		 *   Distance between the start of each row, in bytes.
+		 *
+		 * @param dims
+		 *   Number of pixels to check in each row, and the number of rows.
+		 *
+		 * @return The MaskKind matching the \ref Mask bits set in any pixel.
+		 */
+		static MaskKind usedMaskKind(const uint8_t *mask, size_t stride,
+			const Point& dims);
+
+		/// Are all the bytes in a buffer the same?
+		/**
+		 * @param data
+		 *   Buffer to check.
+		 *
+		 * @param len
+		 *   Length of data, in bytes.
+		 *
+		 * @return true if every byte matches the first, or len is zero.
+		 */
+		static bool allSame(const uint8_t *data, size_t len);
+
+		/// Are all the bytes in part of a stream the same?
+		/**
+		 * Helper function for isUniform() implementations that can check the
+		 * stored image data directly.
+		 *
+		 * @param content
+		 *   Stream to read.
+		 *
+		 * @param offset
+		 *   Offset of the first byte to check.
+		 *
+		 * @param len
+		 *   Number of bytes to check.  Must not be zero.
+		 *
+		 * @param value
+		 *   On return, set to the value of the first byte.
+		 *
+		 * @return true if every byte has the same value.
+		 *
+		 * @throw stream::error on I/O error.
+		 */
+		static bool allSame(stream::input& content, stream::pos offset,
+			stream::len len, uint8_t *value);
+
+		/// Pack one row of 8bpp pixels into fewer bits per pixel.
+		/**
+		 * Helper function for convertPacked() implementations.
+		 *
+		 * @param dst
+		 *   Destination, (width * bpp + 7) / 8 bytes long.  Any unused bits in
+		 *   the last byte are set to zero.
+		 *
+		 * @param src
+		 *   Source pixels, width bytes long.  Bits above the lowest bpp bits are
+		 *   ignored.
+		 *
+		 * @param width
+		 *   Number of pixels in the row.
+		 *
+		 * @param bpp
+		 *   Bits per pixel in the destination, as returned by bitsPerPixel().
+		 */
+		static void packRow(uint8_t *dst, const uint8_t *src, long width,
+			unsigned int bpp);
+
+		/// Pack one bit of each pixel in a row into a 1bpp plane.
+		/**
+		 * Helper function for convertMaskPacked() implementations.
+		 *
+		 * @param dst
+		 *   Destination, (width + 7) / 8 bytes long.  Any unused bits in the last
+		 *   byte are set to zero.
+		 *
+		 * @param src
+		 *   Source pixels, width bytes long.
+		 *
+		 * @param width
+		 *   Number of pixels in the row.
+		 *
+		 * @param bit
+		 *   Bit to test in each source pixel, e.g. Mask::Transparent.
+		 */
+		static void packBits(uint8_t *dst, const uint8_t *src, long width,
+			uint8_t bit);
+
+		/// Apply a palette and mask to 8bpp pixels, producing 32-bit RGBA.
+		/**
+		 * Helper function for convertRGBA() implementations.
+		 *
+		 * @param dst
+		 *   Destination, count * 4 bytes long.
+		 *
+		 * @param pixels
+		 *   Source pixels, count bytes long.
+		 *
+		 * @param mask
+		 *   Source mask, count bytes long.
+		 *
+		 * @param count
+		 *   Number of pixels to convert.
+		 *
+		 * @param palette
+		 *   Palette to apply.
+		 */
+		static void expandRGBA(uint8_t *dst, const uint8_t *pixels,
+			const uint8_t *mask, long count, const Palette& palette);
+
 		std::shared_ptr<const Palette> pal; ///< Palette storage, may be null
 };
 
+/// Decoded copy of an Image, returned by Image::snapshot().
+/**
+ * This only ever exists as a shared pointer to a const instance, so the
+ * content cannot change after it has been created.
+ */
+struct CAMOTO_GAMEGRAPHICS_API ImageSnapshot
+{
+	Image::Caps caps;         ///< Capabilities of the original image
+	ColourDepth colourDepth;  ///< Colour depth of the original image
+	Point dimensions;         ///< Image size, in pixels
+	Pixels pixels;            ///< Same as Image::convert()
+	Pixels mask;              ///< Same as Image::convert_mask()
+
+	/// Same as Image::hotspot(), or {0, 0} if caps lacks HasHotspot
+	Point hotspot;
+
+	/// Same as Image::hitrect(), or {0, 0} if caps lacks HasHitRect
+	Point hitrect;
+
+	/// Same as Image::palette(), or null if caps lacks HasPalette
+	std::shared_ptr<const Palette> palette;
+};
+
 inline Image::Caps operator| (Image::Caps a, Image::Caps b) {
 	return static_cast<Image::Caps>(
 		static_cast<unsigned int>(a) | static_cast<unsigned int>(b)
@@ -297,6 +1197,18 @@ inline bool operator& (Image::Mask a, Image::Mask b) {
 	;
 }
 
+inline Image::MaskKind operator| (Image::MaskKind a, Image::MaskKind b) {
+	return static_cast<Image::MaskKind>(
+		static_cast<unsigned int>(a) | static_cast<unsigned int>(b)
+	);
+}
+
+inline bool operator& (Image::MaskKind a, Image::MaskKind b) {
+	return
+		static_cast<unsigned int>(a) & static_cast<unsigned int>(b)
+	;
+}
+
 } // namespace gamegraphics
 } // namespace camoto
 
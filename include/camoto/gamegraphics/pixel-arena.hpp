@@ -0,0 +1,214 @@
+/**
+ * @file  camoto/gamegraphics/pixel-arena.hpp
+ * @brief Custom memory allocation for pixel buffers.
+ *
+ * Copyright (C) 2010-2017 Adam Nielsen <malvineous@shikadi.net>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CAMOTO_GAMEGRAPHICS_PIXEL_ARENA_HPP_
+#define _CAMOTO_GAMEGRAPHICS_PIXEL_ARENA_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <vector>
+#include <camoto/config.hpp>
+
+namespace camoto {
+namespace gamegraphics {
+
+/// Source of memory for pixel buffers.
+/**
+ * An arena can be installed for the current thread with PixelArenaScope, and
+ * any scratch buffers (see \ref ArenaPixels) created on that thread while the
+ * scope is active will take their memory from the arena instead of the heap.
+ * This is typically used to group the many small temporary allocations made
+ * while exporting a whole tileset, so they don't contend with other threads
+ * for the global heap.
+ *
+ * Only ArenaPixels buffers use the arena.  Image data (\ref Pixels), and
+ * anything kept by an Image, always comes from the heap, so it is unaffected
+ * when the arena is destroyed.  The arena must still outlive every
+ * ArenaPixels buffer allocated from it.
+ */
+class CAMOTO_GAMEGRAPHICS_API PixelArena
+{
+	public:
+		virtual ~PixelArena();
+
+		/// Allocate a block of memory.
+		/**
+		 * @param len
+		 *   Number of bytes required.
+		 *
+		 * @return Pointer to the memory, suitably aligned for any type.
+		 *
+		 * @throw std::bad_alloc if there is no memory available.
+		 */
+		virtual void *allocate(std::size_t len) = 0;
+
+		/// Return a block of memory obtained from allocate().
+		/**
+		 * @param ptr
+		 *   Value previously returned by allocate().
+		 *
+		 * @param len
+		 *   Same value passed to allocate().
+		 */
+		virtual void deallocate(void *ptr, std::size_t len) = 0;
+
+		/// Get the arena in use by the current thread.
+		/**
+		 * @return The arena installed by the innermost PixelArenaScope on this
+		 *   thread, or nullptr if pixel buffers are coming from the heap.
+		 */
+		static PixelArena *current();
+};
+
+/// Use an arena for pixel buffers allocated by this thread.
+/**
+ * The arena is used from construction until this object goes out of scope,
+ * at which point the previous arena (or the heap) is used again.  Scopes may
+ * be nested.
+ */
+class CAMOTO_GAMEGRAPHICS_API PixelArenaScope
+{
+	public:
+		/// Start using an arena.
+		/**
+		 * @param arena
+		 *   Arena to use, or nullptr to use the heap.
+		 */
+		explicit PixelArenaScope(PixelArena *arena);
+		~PixelArenaScope();
+
+		PixelArenaScope(const PixelArenaScope&) = delete;
+		PixelArenaScope& operator= (const PixelArenaScope&) = delete;
+
+	protected:
+		PixelArena *prev; ///< Arena to restore once this scope ends
+};
+
+/// Arena that hands out memory from large blocks and frees it all at once.
+/**
+ * Allocations are carved sequentially out of blocks obtained from the heap.
+ * Memory returned with deallocate() is only reused if it was the most recent
+ * allocation, which suits the short-lived temporary buffers used while
+ * converting images.  Everything else is freed when the arena is destroyed.
+ *
+ * @note Multithreading: An instance must only be used by one thread at a
+ *   time.  Give each worker thread its own arena.
+ */
+class CAMOTO_GAMEGRAPHICS_API MonotonicPixelArena: public PixelArena
+{
+	public:
+		/// Create a new arena.
+		/**
+		 * @param blockSize
+		 *   Number of bytes to request from the heap at a time.  Allocations
+		 *   larger than this get a block of their own.
+		 */
+		explicit MonotonicPixelArena(std::size_t blockSize = 65536);
+		virtual ~MonotonicPixelArena();
+
+		virtual void *allocate(std::size_t len);
+		virtual void deallocate(void *ptr, std::size_t len);
+
+	protected:
+		std::size_t blockSize;  ///< Default size of each new block
+		std::vector<std::unique_ptr<uint8_t[]>> blocks; ///< All blocks allocated
+		uint8_t *next;          ///< Next free byte in the current block
+		std::size_t remaining;  ///< Bytes left in the current block
+};
+
+/// Standard library allocator that uses the current thread's PixelArena.
+/**
+ * The arena active when the allocator is created is remembered, so a buffer
+ * is always returned to the arena it came from, even if it is freed outside
+ * the PixelArenaScope or on a different thread.
+ */
+template <class T>
+class PixelAllocator
+{
+	public:
+		typedef T value_type;
+		typedef std::true_type propagate_on_container_move_assignment;
+		typedef std::true_type propagate_on_container_swap;
+
+		PixelAllocator()
+			:	arena(PixelArena::current())
+		{
+		}
+
+		template <class U>
+		PixelAllocator(const PixelAllocator<U>& other)
+			:	arena(other.arena)
+		{
+		}
+
+		T *allocate(std::size_t n)
+		{
+			if (this->arena) {
+				return static_cast<T *>(this->arena->allocate(n * sizeof(T)));
+			}
+			return static_cast<T *>(::operator new(n * sizeof(T)));
+		}
+
+		void deallocate(T *ptr, std::size_t n)
+		{
+			if (this->arena) {
+				this->arena->deallocate(ptr, n * sizeof(T));
+				return;
+			}
+			::operator delete(ptr);
+			return;
+		}
+
+		/// Copies of a buffer use the arena active where the copy is made.
+		PixelAllocator select_on_container_copy_construction() const
+		{
+			return PixelAllocator();
+		}
+
+		PixelArena *arena; ///< Arena to use, or nullptr for the heap
+};
+
+template <class T, class U>
+inline bool operator== (const PixelAllocator<T>& a, const PixelAllocator<U>& b)
+{
+	return a.arena == b.arena;
+}
+
+template <class T, class U>
+inline bool operator!= (const PixelAllocator<T>& a, const PixelAllocator<U>& b)
+{
+	return !(a == b);
+}
+
+/// Scratch buffer that takes its memory from the current thread's PixelArena.
+/**
+ * This is used for temporary buffers while converting images.  It is a
+ * different type to \ref Pixels, so a buffer from an arena can't
+ * accidentally be kept by an image that outlives the arena.
+ */
+typedef std::vector<uint8_t, PixelAllocator<uint8_t>> ArenaPixels;
+
+} // namespace gamegraphics
+} // namespace camoto
+
+#endif // _CAMOTO_GAMEGRAPHICS_PIXEL_ARENA_HPP_
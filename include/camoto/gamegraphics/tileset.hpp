@@ -154,6 +154,33 @@ class CAMOTO_GAMEGRAPHICS_API Tileset: virtual public gamearchive::Archive
 		 */
 		virtual std::unique_ptr<Image> openImage(const FileHandle& id) = 0;
 
+		/// Open the given tile in the background.
+		/**
+		 * This is the same as openImage(), but the work is handed to the given
+		 * executor, so the calling thread can carry on while the tile's header is
+		 * read.  Combine with Image::convertAsync() to decode the tile as well.
+		 *
+		 * The task uses the tileset's own stream, so as with all other functions,
+		 * no other function may be called on this tileset or any of its images
+		 * until the returned future is ready.  Several async calls may be queued
+		 * at once only if the executor runs them one at a time, never
+		 * overlapping.
+		 *
+		 * The default implementation runs openImage() on the executor.
+		 *
+		 * @param id
+		 *   ID of the item to open, as returned by files().
+		 *
+		 * @param exec
+		 *   Executor to run openImage() on.  The tileset must remain valid until
+		 *   it has finished.
+		 *
+		 * @return Future for the same value openImage() would return.  Any
+		 *   exception thrown is rethrown by its get() function.
+		 */
+		virtual std::future<std::unique_ptr<Image>> openImageAsync(
+			const FileHandle& id, Executor& exec);
+
 		/// Open the sub-tileset at the given offset.
 		/**
 		 * @note If you make changes to the returned Tileset you will (of course)
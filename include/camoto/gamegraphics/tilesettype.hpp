@@ -155,6 +155,28 @@ class TilesetType
 		 */
 		virtual SuppFilenames getRequiredSupps(stream::input& content,
 			const std::string& filename) const = 0;
+
+		/// Work out how large a tileset file would be.
+		/**
+		 * This is for formats where every tile is stored at a fixed size, so the
+		 * file size depends only on how many tiles there are.  It allows the
+		 * size of a new tileset to be known before anything is written.
+		 *
+		 * The default implementation throws an exception, as the size of most
+		 * formats also depends on the tile content (see Image::encodedSize()).
+		 *
+		 * @param numImages
+		 *   Number of images (tiles) in the tileset.
+		 *
+		 * @return Size of the tileset file, in bytes, including any headers.
+		 *
+		 * @throw stream::error if this format cannot calculate the size.
+		 */
+		virtual stream::len estimateSize(unsigned int numImages) const
+		{
+			throw stream::error("The size of this tileset format depends on its"
+				" content, so it can't be calculated in advance.");
+		}
 };
 
 } // namespace gamegraphics
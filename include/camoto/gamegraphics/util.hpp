@@ -26,9 +26,115 @@
 namespace camoto {
 namespace gamegraphics {
 
+/// One horizontal run of visible pixels in a SpriteSpans.
+struct SpriteSpan
+{
+	long x;        ///< X-coordinate of the first pixel in the run
+	long y;        ///< Y-coordinate of the run
+	long length;   ///< Number of pixels in the run
+	size_t offset; ///< Index of the first pixel in SpriteSpans::pixels
+};
+
+/// Image compiled into a list of visible runs for fast drawing.
+/**
+ * Only the pixels without Mask::Transparent set are kept, grouped into runs
+ * so that each one can be copied with a single memcpy() instead of checking
+ * the mask of every pixel.  Compile a sprite once with compileSpans(), then
+ * draw it as many times as needed with blitSpans().
+ */
+struct SpriteSpans
+{
+	Point dims;                    ///< Size of the original image
+	std::vector<SpriteSpan> spans; ///< Runs, from top to bottom and left to right
+	Pixels pixels;                 ///< Pixel data for all runs, back to back
+	Pixels mask;                   ///< Mask data for all runs, back to back
+};
+
+/// Convert an image into a list of visible runs.
+/**
+ * @param img
+ *   Image to compile.
+ *
+ * @return Compiled sprite.  If the image has no mask, there is one run for
+ *   every row.
+ *
+ * @throw stream::error on I/O error.
+ */
+CAMOTO_GAMEGRAPHICS_API SpriteSpans compileSpans(const Image* img);
+
+/// Draw a compiled sprite into an 8bpp buffer.
+/**
+ * Any part of the sprite that falls outside the destination is clipped.
+ *
+ * @param sprite
+ *   Sprite from compileSpans().
+ *
+ * @param pos
+ *   Location in the destination of the sprite's top-left corner.  This may
+ *   be negative.
+ *
+ * @param pixels
+ *   Destination pixel data, in the same format as Image::convert().
+ *
+ * @param mask
+ *   Destination mask data, in the same format as Image::convert_mask(), or
+ *   nullptr to leave the mask alone.
+ *
+ * @param dims
+ *   Dimensions of the destination, in pixels.
+ */
+CAMOTO_GAMEGRAPHICS_API void blitSpans(const SpriteSpans& sprite,
+	const Point& pos, uint8_t *pixels, uint8_t *mask, const Point& dims);
+
 /// Overlay one image onto another and return a new combined image.
 CAMOTO_GAMEGRAPHICS_API std::unique_ptr<Image> overlayImage(const Image* base, const Image* overlay);
 
+/// Remove the transparent border from an image.
+/**
+ * The returned image only contains the area given by Image::opaqueBounds().
+ * Its hotspot is moved to match, so drawing it at the same location as the
+ * original puts every visible pixel in the same place.  Images without a
+ * hotspot are treated as having one at (0,0), so the trimmed image always
+ * has one.
+ *
+ * The result is a view over the original image, sharing a single decoded
+ * copy of it.  Changes made to the trimmed image with Image::convert() are
+ * written straight back to the original.
+ *
+ * @param img
+ *   Image to trim.  It must remain valid for as long as the trimmed image is
+ *   in use.
+ *
+ * @return New image.  If every pixel was transparent, it is 0x0 pixels.
+ *
+ * @throw stream::error on I/O error.
+ */
+CAMOTO_GAMEGRAPHICS_API std::unique_ptr<Image> trimImage(Image* img);
+
+/// Check whether two sprites touch each other.
+/**
+ * The bitmaps are compared 64 pixels at a time, so this is fast enough to
+ * run over every pair of sprites in a scene.
+ *
+ * @param a
+ *   Collision map of the first sprite, from Image::hitBitmap().
+ *
+ * @param posA
+ *   Location of the top-left corner of the first sprite.
+ *
+ * @param b
+ *   Collision map of the second sprite.
+ *
+ * @param posB
+ *   Location of the top-left corner of the second sprite, in the same
+ *   coordinate system as posA.
+ *
+ * @return true if any solid pixel in one sprite lies on top of a solid pixel
+ *   in the other.
+ */
+CAMOTO_GAMEGRAPHICS_API bool hitTest(const HitBitmap& a, const Point& posA,
+	const HitBitmap& b, const Point& posB);
+
 } // namespace gamegraphics
 } // namespace camoto
 
@@ -0,0 +1,111 @@
+/**
+ * @file  content-hash.hpp
+ * @brief Hash function used by Image::contentHash().
+ *
+ * Copyright (C) 2010-2017 Adam Nielsen <malvineous@shikadi.net>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CAMOTO_CONTENT_HASH_HPP_
+#define _CAMOTO_CONTENT_HASH_HPP_
+
+#include <algorithm>
+#include <cstdint>
+#include <camoto/stream.hpp>
+#include <camoto/gamegraphics/image.hpp>
+
+/// Size of each block read from the stream while hashing
+#define CONTENT_HASH_BUFFER_SIZE 4096
+
+namespace camoto {
+namespace gamegraphics {
+
+/// 64-bit FNV-1a hash of image data.
+/**
+ * The hash starts with the kind of data being hashed and the image
+ * dimensions, so the same bytes hashed as encoded and as decoded data, or as
+ * images of different shapes, give different results.
+ */
+class ContentHash
+{
+	public:
+		/// What the hashed bytes represent.
+		enum class Domain: uint8_t {
+			Decoded = 'D', ///< Standard 8bpp pixels followed by the mask
+			Encoded = 'E', ///< Image data as stored by the file format
+		};
+
+		ContentHash(Domain domain, const Point& dims)
+			:	hash(0xCBF29CE484222325ULL)
+		{
+			this->add((uint8_t)domain);
+			this->add((uint32_t)dims.x);
+			this->add((uint32_t)dims.y);
+		}
+
+		/// Add a block of memory to the hash.
+		void add(const uint8_t *data, stream::len len)
+		{
+			uint64_t h = this->hash;
+			for (stream::len i = 0; i < len; i++) {
+				h ^= data[i];
+				h *= 0x100000001B3ULL;
+			}
+			this->hash = h;
+			return;
+		}
+
+		/// Add part of a stream to the hash.
+		/**
+		 * @throw stream::incomplete_read if the stream ends first.
+		 */
+		void add(stream::input& content, stream::pos offset, stream::len len)
+		{
+			uint8_t buffer[CONTENT_HASH_BUFFER_SIZE];
+			content.seekg(offset, stream::start);
+			while (len) {
+				stream::len lenBlock = std::min<stream::len>(len, sizeof(buffer));
+				content.read(buffer, lenBlock);
+				this->add(buffer, lenBlock);
+				len -= lenBlock;
+			}
+			return;
+		}
+
+		/// Get the hash of everything added so far.
+		uint64_t value() const
+		{
+			return this->hash;
+		}
+
+	protected:
+		/// Add a single value to the hash, least significant byte first.
+		template <class T>
+		void add(T val)
+		{
+			for (unsigned int i = 0; i < sizeof(T); i++) {
+				uint8_t b = (uint8_t)(val >> (i * 8));
+				this->add(&b, 1);
+			}
+			return;
+		}
+
+		uint64_t hash; ///< Hash of the data added so far
+};
+
+} // namespace gamegraphics
+} // namespace camoto
+
+#endif // _CAMOTO_CONTENT_HASH_HPP_
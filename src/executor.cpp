@@ -0,0 +1,41 @@
+/**
+ * @file  executor.cpp
+ * @brief Interface for running conversions in the background.
+ *
+ * Copyright (C) 2010-2017 Adam Nielsen <malvineous@shikadi.net>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <camoto/gamegraphics/executor.hpp>
+
+namespace camoto {
+namespace gamegraphics {
+
+Executor::~Executor()
+{
+}
+
+ImmediateExecutor::~ImmediateExecutor()
+{
+}
+
+void ImmediateExecutor::submit(std::function<void()> task)
+{
+	task();
+	return;
+}
+
+} // namespace gamegraphics
+} // namespace camoto
@@ -0,0 +1,87 @@
+/**
+ * @file  header-cache.hpp
+ * @brief Cache of a value parsed from an image header.
+ *
+ * Copyright (C) 2010-2017 Adam Nielsen <malvineous@shikadi.net>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CAMOTO_HEADER_CACHE_HPP_
+#define _CAMOTO_HEADER_CACHE_HPP_
+
+namespace camoto {
+namespace gamegraphics {
+
+/// Value read from the underlying stream, kept until the stream is changed.
+/**
+ * Some Image implementations read fields such as the image dimensions out of
+ * the file header every time they are needed.  This holds on to the parsed
+ * value, so the stream is only read the first time.  The owner must call
+ * invalidate() (or set()) whenever it writes to the part of the stream the
+ * value came from, and should also call invalidate() from Image::dropCache().
+ *
+ * Declare the member as mutable so it can be filled from const functions.
+ */
+template <class T>
+class HeaderCache
+{
+	public:
+		HeaderCache()
+			:	loaded(false)
+		{
+		}
+
+		/// Get the value, reading it from the stream first if needed.
+		/**
+		 * @param fnRead
+		 *   Function taking no parameters and returning a T, which is only
+		 *   called if the value has not been read yet or has been invalidated.
+		 *
+		 * @return The cached value.
+		 */
+		template <class F>
+		const T& get(F fnRead)
+		{
+			if (!this->loaded) {
+				this->value = fnRead();
+				this->loaded = true;
+			}
+			return this->value;
+		}
+
+		/// Replace the value, after writing it to the stream.
+		void set(const T& newValue)
+		{
+			this->value = newValue;
+			this->loaded = true;
+			return;
+		}
+
+		/// Forget the value, so it is read again on the next call to get().
+		void invalidate()
+		{
+			this->loaded = false;
+			return;
+		}
+
+	protected:
+		T value;     ///< Cached value, only meaningful if loaded is true
+		bool loaded; ///< true if value is current
+};
+
+} // namespace gamegraphics
+} // namespace camoto
+
+#endif // _CAMOTO_HEADER_CACHE_HPP_
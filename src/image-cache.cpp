@@ -0,0 +1,74 @@
+/**
+ * @file  image-cache.cpp
+ * @brief Cache of decoded image data.
+ *
+ * Copyright (C) 2010-2017 Adam Nielsen <malvineous@shikadi.net>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "image-cache.hpp"
+
+namespace camoto {
+namespace gamegraphics {
+
+ImageCache::ImageCache()
+	:	keep(true),
+		populated(false)
+{
+}
+
+bool ImageCache::valid() const
+{
+	return this->populated;
+}
+
+bool ImageCache::enabled() const
+{
+	return this->keep;
+}
+
+void ImageCache::enabled(bool keep)
+{
+	this->keep = keep;
+	if (!keep) this->release();
+	return;
+}
+
+void ImageCache::invalidate()
+{
+	this->release();
+	return;
+}
+
+void ImageCache::release()
+{
+	// Drop our reference so the memory is freed once no one else is using it
+	this->pixels = SharedPixels();
+	this->mask = SharedPixels();
+	this->populated = false;
+	return;
+}
+
+void ImageCache::store(Pixels newPixels, Pixels newMask)
+{
+	if (!this->keep) return;
+	this->pixels = SharedPixels(std::move(newPixels));
+	this->mask = SharedPixels(std::move(newMask));
+	this->populated = true;
+	return;
+}
+
+} // namespace gamegraphics
+} // namespace camoto
@@ -0,0 +1,93 @@
+/**
+ * @file  image-cache.hpp
+ * @brief Cache of decoded image data.
+ *
+ * Copyright (C) 2010-2017 Adam Nielsen <malvineous@shikadi.net>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CAMOTO_IMAGE_CACHE_HPP_
+#define _CAMOTO_IMAGE_CACHE_HPP_
+
+#include <camoto/config.hpp>
+#include <camoto/gamegraphics/image.hpp>
+
+namespace camoto {
+namespace gamegraphics {
+
+/// Decoded copy of an image's pixels and mask.
+/**
+ * This is used by Image implementations that are slow to decode, so that
+ * repeated calls to Image::convert() don't have to decode the underlying data
+ * every time.
+ *
+ * The cache only notices changes made through the Image that owns it, which
+ * must call invalidate() whenever it writes to the underlying data.  If the
+ * same data is modified some other way, such as through a second Image opened
+ * on the same stream or tileset entry, this cache will keep returning the old
+ * content until invalidate() or release() is called.  Caching can also be
+ * switched off entirely for one-shot decoding, where keeping a copy would
+ * only waste memory.
+ *
+ * The data is held in SharedPixels buffers, so it can be handed out by
+ * Image::convertShared() without being copied.  Invalidating the cache does
+ * not affect buffers that have already been handed out.
+ */
+class CAMOTO_GAMEGRAPHICS_API ImageCache
+{
+	public:
+		ImageCache();
+
+		/// Is there cached data?
+		bool valid() const;
+
+		/// Will store() keep the data it is given?
+		bool enabled() const;
+
+		/// Enable or disable the cache.
+		/**
+		 * @param keep
+		 *   true to keep decoded data, false to discard it immediately.
+		 *   Disabling the cache also releases any data already held.
+		 */
+		void enabled(bool keep);
+
+		/// Note that the underlying image has changed.
+		/**
+		 * Any cached data is released, so the next read decodes it again.
+		 */
+		void invalidate();
+
+		/// Free the cached data to save memory.
+		void release();
+
+		/// Keep the given decoded data.
+		/**
+		 * Does nothing if the cache is disabled.
+		 */
+		void store(Pixels newPixels, Pixels newMask);
+
+		SharedPixels pixels; ///< Cached pixel data, only meaningful if valid()
+		SharedPixels mask;   ///< Cached mask data, only meaningful if valid()
+
+	protected:
+		bool keep;      ///< false to not store anything
+		bool populated; ///< true if pixels and mask have been stored
+};
+
+} // namespace gamegraphics
+} // namespace camoto
+
+#endif // _CAMOTO_IMAGE_CACHE_HPP_
@@ -19,6 +19,7 @@
  */
 
 #include <cassert>
+#include <camoto/util.hpp> // createString
 #include "image-from_tileset.hpp"
 
 namespace camoto {
@@ -68,40 +69,131 @@ void Image_FromTileset::dimensions(const Point& newDimensions)
 
 Pixels Image_FromTileset::convert() const
 {
-	if (this->pixels.size() == 0) {
-		// Populate cache
-		auto noconst_this = const_cast<Image_FromTileset*>(this);
-		noconst_this->doConversion(true);
+	if (!this->cache.valid()) {
+		Pixels pixels, mask;
+		this->decode(pixels, mask);
+		if (!this->cache.enabled()) return pixels;
+		this->cache.store(std::move(pixels), std::move(mask));
 	}
-	return this->pixels;
+	return *this->cache.pixels;
 }
 
 Pixels Image_FromTileset::convert_mask() const
 {
-	if (this->mask.size() == 0) {
-		// Populate cache
-		auto noconst_this = const_cast<Image_FromTileset*>(this);
-		noconst_this->doConversion(true);
+	if (!this->cache.valid()) {
+		Pixels pixels, mask;
+		this->decode(pixels, mask);
+		if (!this->cache.enabled()) return mask;
+		this->cache.store(std::move(pixels), std::move(mask));
 	}
-	return this->mask;
+	return *this->cache.mask;
+}
+
+void Image_FromTileset::convertBoth(Pixels& pixels, Pixels& mask) const
+{
+	if (!this->cache.valid()) {
+		// Both are populated by the same pass over the tiles
+		if (!this->cache.enabled()) {
+			// Nothing to keep, so decode straight into the caller's buffers
+			this->decode(pixels, mask);
+			return;
+		}
+		Pixels newPixels, newMask;
+		this->decode(newPixels, newMask);
+		this->cache.store(std::move(newPixels), std::move(newMask));
+	}
+	pixels = *this->cache.pixels;
+	mask = *this->cache.mask;
+	return;
+}
+
+SharedPixels Image_FromTileset::convertShared() const
+{
+	if (!this->cache.valid()) {
+		Pixels pixels, mask;
+		this->decode(pixels, mask);
+		if (!this->cache.enabled()) return SharedPixels(std::move(pixels));
+		this->cache.store(std::move(pixels), std::move(mask));
+	}
+	// Hand out the cached buffer itself rather than a copy
+	return this->cache.pixels;
+}
+
+void Image_FromTileset::convertBothShared(SharedPixels& pixels, SharedPixels& mask)
+	const
+{
+	if (!this->cache.valid()) {
+		Pixels newPixels, newMask;
+		this->decode(newPixels, newMask);
+		if (!this->cache.enabled()) {
+			pixels = SharedPixels(std::move(newPixels));
+			mask = SharedPixels(std::move(newMask));
+			return;
+		}
+		this->cache.store(std::move(newPixels), std::move(newMask));
+	}
+	pixels = this->cache.pixels;
+	mask = this->cache.mask;
+	return;
 }
 
 void Image_FromTileset::convert(const Pixels& newContent,
 	const Pixels& newMask)
 {
-	this->pixels = newContent;
-	this->mask = newMask;
-	this->doConversion(false);
+	this->encodeTiles(newContent, newMask);
+	this->cache.invalidate();
+	this->cache.store(newContent, newMask);
 	return;
 }
 
-void Image_FromTileset::doConversion(bool toImage)
+void Image_FromTileset::convert(Pixels&& newContent, Pixels&& newMask)
 {
-	auto tileDims = this->tileset->dimensions();
-	if (toImage) {
-		this->pixels.resize(this->dimsInPixels.x * this->dimsInPixels.y);
-		this->mask.resize(this->dimsInPixels.x * this->dimsInPixels.y);
+	this->encodeTiles(newContent, newMask);
+	this->cache.invalidate();
+	this->cache.store(std::move(newContent), std::move(newMask));
+	return;
+}
+
+void Image_FromTileset::convertInto(uint8_t *pixels, uint8_t *mask,
+	size_t stride) const
+{
+	assert(stride >= (size_t)this->dimsInPixels.x);
+	if (this->cache.valid()) {
+		// Already decoded, use the cache
+		if (pixels) this->copyRows(pixels, stride, this->dimsInPixels,
+			this->cache.pixels.data());
+		if (mask) this->copyRows(mask, stride, this->dimsInPixels,
+			this->cache.mask.data());
+		return;
 	}
+	this->decodeTiles(pixels, mask, stride);
+	return;
+}
+
+void Image_FromTileset::dropCache()
+{
+	this->cache.release();
+	return;
+}
+
+void Image_FromTileset::cacheDecoded(bool keep)
+{
+	this->cache.enabled(keep);
+	return;
+}
+
+void Image_FromTileset::decode(Pixels& pixels, Pixels& mask) const
+{
+	pixels.assign(this->dimsInPixels.x * this->dimsInPixels.y, 0);
+	mask.assign(this->dimsInPixels.x * this->dimsInPixels.y, 0);
+	this->decodeTiles(pixels.data(), mask.data(), this->dimsInPixels.x);
+	return;
+}
+
+void Image_FromTileset::encodeTiles(const Pixels& newContent,
+	const Pixels& newMask)
+{
+	auto tileDims = this->tileset->dimensions();
 	auto tiles = this->tileset->files();
 	unsigned int firstTileOnRow = this->first;
 	for (int y = 0; y < this->dimsInTiles.y; y++) {
@@ -111,31 +203,22 @@ void Image_FromTileset::doConversion(bool toImage)
 			// TODO: assert tileHandle->index (if present) matches tileIndex
 			auto tile = this->tileset->openImage(tileHandle);
 			Pixels tileImg, tileMask;
-			if (toImage) {
-				tileImg = tile->convert();
-				tileMask = tile->convert_mask();
-			} else {
-				tileImg.resize(tileDims.x * tileDims.y);
-				tileMask.resize(tileDims.x * tileDims.y);
-			}
-			unsigned int dstOffset = y * tileDims.y * this->dimsInPixels.x
+			tileImg.resize(tileDims.x * tileDims.y);
+			tileMask.resize(tileDims.x * tileDims.y);
+			unsigned int srcOffset = y * tileDims.y * this->dimsInPixels.x
 				+ x * tileDims.x;
-			auto blit = [this, toImage, dstOffset, &tileDims]
-				(Pixels& dst, Pixels& src)
+			auto blit = [this, srcOffset, &tileDims]
+				(Pixels& dst, const Pixels& src)
 			{
 				for (int ty = 0; ty < tileDims.y; ty++) {
-					auto pDst = &dst[dstOffset + ty * this->dimsInPixels.x];
-					auto pSrc = &src[ty * tileDims.x];
-					if (!toImage) std::swap(pDst, pSrc);
-					memcpy(pDst, pSrc, tileDims.x);
+					memcpy(&dst[ty * tileDims.x],
+						&src[srcOffset + ty * this->dimsInPixels.x], tileDims.x);
 				}
 				return;
 			};
-			blit(this->pixels, tileImg);
-			blit(this->mask, tileMask);
-			if (!toImage) {
-				tile->convert(tileImg, tileMask);
-			}
+			blit(tileImg, newContent);
+			blit(tileMask, newMask);
+			tile->convert(std::move(tileImg), std::move(tileMask));
 		}
 		firstTileOnRow += this->span;
 	}
@@ -143,5 +226,37 @@ void Image_FromTileset::doConversion(bool toImage)
 	return;
 }
 
+void Image_FromTileset::decodeTiles(uint8_t *pixels, uint8_t *mask,
+	size_t stride) const
+{
+	auto tileDims = this->tileset->dimensions();
+	auto tiles = this->tileset->files();
+	unsigned int firstTileOnRow = this->first;
+	for (int y = 0; y < this->dimsInTiles.y; y++) {
+		for (int x = 0; x < this->dimsInTiles.x; x++) {
+			auto tileIndex = firstTileOnRow + x;
+			auto& tileHandle = tiles[tileIndex];
+			// TODO: assert tileHandle->index (if present) matches tileIndex
+			auto tile = this->tileset->openImage(tileHandle);
+			auto actualDims = tile->dimensions();
+			if ((actualDims.x != tileDims.x) || (actualDims.y != tileDims.y)) {
+				throw stream::error(createString("Tile " << tileIndex << " is "
+					<< actualDims.x << "x" << actualDims.y << " but the tileset "
+					"requires all tiles to be " << tileDims.x << "x" << tileDims.y));
+			}
+
+			// Have the tile write itself straight into its spot in the image
+			unsigned int dstOffset = y * tileDims.y * stride + x * tileDims.x;
+			tile->convertInto(
+				pixels ? pixels + dstOffset : nullptr,
+				mask ? mask + dstOffset : nullptr,
+				stride
+			);
+		}
+		firstTileOnRow += this->span;
+	}
+	return;
+}
+
 } // namespace gamegraphics
 } // namespace camoto
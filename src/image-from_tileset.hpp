@@ -23,6 +23,7 @@
 
 #include <camoto/config.hpp>
 #include <camoto/gamegraphics/tileset.hpp>
+#include "image-cache.hpp"
 
 namespace camoto {
 namespace gamegraphics {
@@ -59,9 +60,19 @@ class CAMOTO_GAMEGRAPHICS_API Image_FromTileset: public Image
 		virtual ColourDepth colourDepth() const;
 		virtual Point dimensions() const;
 		virtual void dimensions(const Point& newDimensions);
+		using Image::convert;
 		virtual Pixels convert() const;
 		virtual Pixels convert_mask() const;
+		virtual void convertBoth(Pixels& pixels, Pixels& mask) const;
+		virtual SharedPixels convertShared() const;
+		virtual void convertBothShared(SharedPixels& pixels, SharedPixels& mask)
+			const;
 		virtual void convert(const Pixels& newContent, const Pixels& newMask);
+		virtual void convert(Pixels&& newContent, Pixels&& newMask);
+		virtual void convertInto(uint8_t *pixels, uint8_t *mask, size_t stride)
+			const;
+		virtual void dropCache();
+		virtual void cacheDecoded(bool keep);
 
 	private:
 		std::shared_ptr<Tileset> tileset;
@@ -69,12 +80,16 @@ class CAMOTO_GAMEGRAPHICS_API Image_FromTileset: public Image
 		unsigned int span;
 		Point dimsInTiles;
 
-		/// toImage: Populate this->pixels and this->mask, !toImage: populate tileset
-		virtual void doConversion(bool toImage);
+		/// Decode the whole image into newly allocated buffers.
+		void decode(Pixels& pixels, Pixels& mask) const;
 
-		// Cached content
-		Pixels pixels;
-		Pixels mask;
+		/// Split the given image up and write it into the tileset.
+		void encodeTiles(const Pixels& newContent, const Pixels& newMask);
+
+		/// Decode each tile directly into the given buffers.
+		void decodeTiles(uint8_t *pixels, uint8_t *mask, size_t stride) const;
+
+		mutable ImageCache cache; ///< Decoded copy of the image
 		Point dimsInPixels;
 		std::shared_ptr<const Palette> pal;
 };
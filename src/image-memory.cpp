@@ -18,6 +18,7 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
 #include <camoto/gamegraphics/image-memory.hpp>
 
 namespace camoto {
@@ -27,12 +28,39 @@ Image_Memory::Image_Memory(const Point& dims, const Pixels& pixels,
 	const Pixels& mask, const Point& hotspot, const Point& hitrect,
 	std::shared_ptr<const Palette> pal)
 	:	dims(dims),
-		pixels(pixels),
-		mask(mask),
+		pixels(Pixels(pixels)),
+		mask(Pixels(mask)),
 		ptHotspot(hotspot),
 		ptHitrect(hitrect)
 {
 	this->pal = pal;
+	this->updateMaskKind();
+}
+
+Image_Memory::Image_Memory(const Point& dims, Pixels&& pixels, Pixels&& mask,
+	const Point& hotspot, const Point& hitrect,
+	std::shared_ptr<const Palette> pal)
+	:	dims(dims),
+		pixels(std::move(pixels)),
+		mask(std::move(mask)),
+		ptHotspot(hotspot),
+		ptHitrect(hitrect)
+{
+	this->pal = pal;
+	this->updateMaskKind();
+}
+
+Image_Memory::Image_Memory(const Point& dims, SharedPixels pixels,
+	SharedPixels mask, const Point& hotspot, const Point& hitrect,
+	std::shared_ptr<const Palette> pal)
+	:	dims(dims),
+		pixels(std::move(pixels)),
+		mask(std::move(mask)),
+		ptHotspot(hotspot),
+		ptHitrect(hitrect)
+{
+	this->pal = pal;
+	this->updateMaskKind();
 }
 
 Image_Memory::~Image_Memory()
@@ -64,21 +92,63 @@ Point Image_Memory::hitrect() const
 	return this->ptHitrect;
 }
 
+Image::MaskKind Image_Memory::maskKind() const
+{
+	return this->kind;
+}
+
 Pixels Image_Memory::convert() const
 {
-	return this->pixels;
+	return *this->pixels;
 }
 
 Pixels Image_Memory::convert_mask() const
 {
-	return this->mask;
+	return *this->mask;
+}
+
+SharedPixels Image_Memory::convertShared() const
+{
+	return this->pixels;
+}
+
+void Image_Memory::convertBothShared(SharedPixels& pixels, SharedPixels& mask)
+	const
+{
+	pixels = this->pixels;
+	mask = this->mask;
+	return;
 }
 
 void Image_Memory::convert(const Pixels& newContent,
 	const Pixels& newMask)
 {
-	this->pixels = newContent;
-	this->mask = newMask;
+	this->pixels = SharedPixels(newContent);
+	this->mask = SharedPixels(newMask);
+	this->updateMaskKind();
+	return;
+}
+
+void Image_Memory::convert(Pixels&& newContent, Pixels&& newMask)
+{
+	this->pixels = SharedPixels(std::move(newContent));
+	this->mask = SharedPixels(std::move(newMask));
+	this->updateMaskKind();
+	return;
+}
+
+void Image_Memory::convertInto(uint8_t *pixels, uint8_t *mask, size_t stride)
+	const
+{
+	if (pixels) this->copyRows(pixels, stride, this->dims, this->pixels.data());
+	if (mask) this->copyRows(mask, stride, this->dims, this->mask.data());
+	return;
+}
+
+void Image_Memory::updateMaskKind()
+{
+	this->kind = Image::usedMaskKind(this->mask.data(), this->dims.x,
+		{this->dims.x, (long)this->mask.size() / std::max(this->dims.x, 1L)});
 	return;
 }
 
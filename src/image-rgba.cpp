@@ -0,0 +1,165 @@
+/**
+ * @file  image-rgba.cpp
+ * @brief Conversion of indexed image data into 32-bit RGBA.
+ *
+ * Copyright (C) 2010-2017 Adam Nielsen <malvineous@shikadi.net>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <camoto/gamegraphics/image.hpp>
+
+#ifdef __SSSE3__
+#include <tmmintrin.h>
+#endif
+
+namespace camoto {
+namespace gamegraphics {
+
+#ifdef __SSSE3__
+/// Expand up to 16-colour pixels into RGBA, 16 pixels at a time.
+/**
+ * Each channel of the palette fits in a single 16-byte register, so a byte
+ * shuffle looks up all 16 pixels at once.  Setting the top bit of an index
+ * makes the shuffle return zero, which is used for both transparent pixels
+ * and indices beyond the end of the palette.
+ *
+ * @return Number of pixels converted, a multiple of 16.  The caller must
+ *   convert the remainder.
+ */
+static long expandRGBA_SSSE3(uint8_t *dst, const uint8_t *pixels,
+	const uint8_t *mask, long count, const uint8_t (&chan)[4][16])
+{
+	__m128i tRed = _mm_load_si128((const __m128i *)chan[0]);
+	__m128i tGreen = _mm_load_si128((const __m128i *)chan[1]);
+	__m128i tBlue = _mm_load_si128((const __m128i *)chan[2]);
+	__m128i tAlpha = _mm_load_si128((const __m128i *)chan[3]);
+	const __m128i highNibble = _mm_set1_epi8((char)0xF0);
+	const __m128i topBit = _mm_set1_epi8((char)0x80);
+	const __m128i transparent = _mm_set1_epi8((uint8_t)Image::Mask::Transparent);
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i ones = _mm_set1_epi8((char)0xFF);
+
+	long done = 0;
+	for (; done + 16 <= count; done += 16) {
+		__m128i idx = _mm_loadu_si128((const __m128i *)(pixels + done));
+		__m128i m = _mm_loadu_si128((const __m128i *)(mask + done));
+
+		// 0xFF for pixels that are transparent or out of range
+		__m128i blank = _mm_or_si128(
+			_mm_cmpeq_epi8(_mm_and_si128(m, transparent), transparent),
+			_mm_xor_si128(_mm_cmpeq_epi8(_mm_and_si128(idx, highNibble), zero), ones)
+		);
+		idx = _mm_or_si128(idx, _mm_and_si128(blank, topBit));
+
+		__m128i r = _mm_shuffle_epi8(tRed, idx);
+		__m128i g = _mm_shuffle_epi8(tGreen, idx);
+		__m128i b = _mm_shuffle_epi8(tBlue, idx);
+		__m128i a = _mm_shuffle_epi8(tAlpha, idx);
+
+		// Interleave the channels into RGBA order
+		__m128i rgLo = _mm_unpacklo_epi8(r, g);
+		__m128i rgHi = _mm_unpackhi_epi8(r, g);
+		__m128i baLo = _mm_unpacklo_epi8(b, a);
+		__m128i baHi = _mm_unpackhi_epi8(b, a);
+		auto out = (__m128i *)(dst + done * 4);
+		_mm_storeu_si128(out + 0, _mm_unpacklo_epi16(rgLo, baLo));
+		_mm_storeu_si128(out + 1, _mm_unpackhi_epi16(rgLo, baLo));
+		_mm_storeu_si128(out + 2, _mm_unpacklo_epi16(rgHi, baHi));
+		_mm_storeu_si128(out + 3, _mm_unpackhi_epi16(rgHi, baHi));
+	}
+	return done;
+}
+#endif // __SSSE3__
+
+/// Palette prepared for fast conversion of many pixels into RGBA.
+class RGBALookup
+{
+	public:
+		RGBALookup(const Palette& palette)
+			:	numColours(std::min<size_t>(palette.size(), 256))
+		{
+			memset(this->lut, 0, sizeof(this->lut));
+			for (unsigned int i = 0; i < this->numColours; i++) {
+				this->lut[i][0] = palette[i].red;
+				this->lut[i][1] = palette[i].green;
+				this->lut[i][2] = palette[i].blue;
+				this->lut[i][3] = palette[i].alpha;
+			}
+#ifdef __SSSE3__
+			// Same values again, but with each channel kept together
+			memset(this->chan, 0, sizeof(this->chan));
+			for (unsigned int i = 0; i < std::min(this->numColours, 16u); i++) {
+				for (unsigned int c = 0; c < 4; c++) {
+					this->chan[c][i] = this->lut[i][c];
+				}
+			}
+#endif
+		}
+
+		void expand(uint8_t *dst, const uint8_t *pixels, const uint8_t *mask,
+			long count) const
+		{
+			long done = 0;
+#ifdef __SSSE3__
+			if (this->numColours <= 16) {
+				done = expandRGBA_SSSE3(dst, pixels, mask, count, this->chan);
+			}
+#endif
+			// Larger palettes don't fit in a register, and a gather is no faster
+			// than this table lookup, so the remaining pixels are done one at a
+			// time.
+			static const uint8_t blank[4] = {0, 0, 0, 0};
+			for (long i = done; i < count; i++) {
+				bool isTransparent = mask[i] & (uint8_t)Image::Mask::Transparent;
+				memcpy(dst + i * 4, isTransparent ? blank : this->lut[pixels[i]], 4);
+			}
+			return;
+		}
+
+	protected:
+		unsigned int numColours;
+		uint8_t lut[256][4];
+#ifdef __SSSE3__
+		alignas(16) uint8_t chan[4][16];
+#endif
+};
+
+Pixels Image::convertRGBA(const Palette& palette) const
+{
+	auto dims = this->dimensions();
+	Pixels rgba(dims.x * dims.y * 4);
+	if (rgba.empty()) return rgba;
+
+	// Prepare the palette once rather than for every row
+	RGBALookup lookup(palette);
+	this->decodeRows([&rgba, &lookup, dims](long y, const uint8_t *rowPixels,
+		const uint8_t *rowMask) {
+		lookup.expand(&rgba[y * dims.x * 4], rowPixels, rowMask, dims.x);
+	});
+	return rgba;
+}
+
+void Image::expandRGBA(uint8_t *dst, const uint8_t *pixels,
+	const uint8_t *mask, long count, const Palette& palette)
+{
+	RGBALookup lookup(palette);
+	lookup.expand(dst, pixels, mask, count);
+	return;
+}
+
+} // namespace gamegraphics
+} // namespace camoto
@@ -33,6 +33,24 @@ Image_Sub::Image_Sub(std::shared_ptr<Pixels> stdImg,
 		dimsViewport(dimsViewport),
 		depth(depth),
 		pal(pal),
+		hasHotspot(false),
+		ptHotspot{0, 0},
+		fnImageChanged(fnImageChanged)
+{
+}
+
+Image_Sub::Image_Sub(std::shared_ptr<Pixels> stdImg,
+	std::shared_ptr<Pixels> stdMask, Point dimsFull, Rect dimsViewport,
+	ColourDepth depth, std::shared_ptr<const Palette> pal, const Point& hotspot,
+	fn_image_changed fnImageChanged)
+	:	stdImg(stdImg),
+		stdMask(stdMask),
+		dimsFull(dimsFull),
+		dimsViewport(dimsViewport),
+		depth(depth),
+		pal(pal),
+		hasHotspot(true),
+		ptHotspot(hotspot),
 		fnImageChanged(fnImageChanged)
 {
 }
@@ -43,7 +61,8 @@ Image_Sub::~Image_Sub()
 
 Image::Caps Image_Sub::caps() const
 {
-	return this->pal ? Caps::HasPalette : Caps::Default;
+	return (this->pal ? Caps::HasPalette : Caps::Default)
+		| (this->hasHotspot ? Caps::HasHotspot : Caps::Default);
 }
 
 ColourDepth Image_Sub::colourDepth() const
@@ -56,14 +75,19 @@ Point Image_Sub::dimensions() const
 	return {this->dimsViewport.width, this->dimsViewport.height};
 }
 
-Pixels Image_Sub::convert() const
+Point Image_Sub::hotspot() const
 {
-	return this->extractPortion(*this->stdImg);
+	return this->ptHotspot;
 }
 
-Pixels Image_Sub::convert_mask() const
+Image::MaskKind Image_Sub::maskKind() const
 {
-	return this->extractPortion(*this->stdMask);
+	// The mask is shared with the parent and can change at any time, so check
+	// what is actually in this portion of it now.
+	return Image::usedMaskKind(
+		this->stdMask->data() + this->dimsViewport.y * this->dimsFull.x
+			+ this->dimsViewport.x,
+		this->dimsFull.x, {this->dimsViewport.width, this->dimsViewport.height});
 }
 
 void Image_Sub::convert(const Pixels& newContent, const Pixels& newMask)
@@ -91,23 +115,28 @@ void Image_Sub::convert(const Pixels& newContent, const Pixels& newMask)
 	return;
 }
 
-Pixels Image_Sub::extractPortion(const Pixels& source) const
+void Image_Sub::convertInto(uint8_t *pixels, uint8_t *mask, size_t stride)
+	const
 {
-	Pixels dest;
-	dest.resize(this->dimsViewport.width * this->dimsViewport.height);
+	if (pixels) this->extractPortion(*this->stdImg, pixels, stride);
+	if (mask) this->extractPortion(*this->stdMask, mask, stride);
+	return;
+}
 
+void Image_Sub::extractPortion(const Pixels& source, uint8_t *dest,
+	size_t stride) const
+{
 	auto src = source.data();
-	auto dst = dest.data();
 
 	// Copy the data out of the main image
 	src += this->dimsViewport.y * this->dimsFull.x;
 	for (int y = 0; y < this->dimsViewport.height; y++) {
-		memcpy(dst, src + this->dimsViewport.x, this->dimsViewport.width);
+		memcpy(dest, src + this->dimsViewport.x, this->dimsViewport.width);
 		src += this->dimsFull.x;
-		dst += this->dimsViewport.width;
+		dest += stride;
 	}
 
-	return dest;
+	return;
 }
 
 } // namespace gamegraphics
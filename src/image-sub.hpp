@@ -79,19 +79,36 @@ class CAMOTO_GAMEGRAPHICS_API Image_Sub: virtual public Image
 		Image_Sub(std::shared_ptr<Pixels> stdImg, std::shared_ptr<Pixels> stdMask,
 			Point dimsFull, Rect dimsViewport, ColourDepth depth,
 			std::shared_ptr<const Palette> pal, fn_image_changed fnImageChanged);
+
+		/// Create a sub-image with a hotspot.
+		/**
+		 * This is the same as the other constructor, except hotspot() will
+		 * return the given value.
+		 *
+		 * @param hotspot
+		 *   Hotspot of this image, relative to its own top-left corner.
+		 */
+		Image_Sub(std::shared_ptr<Pixels> stdImg, std::shared_ptr<Pixels> stdMask,
+			Point dimsFull, Rect dimsViewport, ColourDepth depth,
+			std::shared_ptr<const Palette> pal, const Point& hotspot,
+			fn_image_changed fnImageChanged);
 		virtual ~Image_Sub();
 
 		virtual Caps caps() const;
 		virtual ColourDepth colourDepth() const;
 		virtual Point dimensions() const;
-		virtual Pixels convert() const;
-		virtual Pixels convert_mask() const;
+		virtual Point hotspot() const;
+		virtual MaskKind maskKind() const;
+		using Image::convert;
 		virtual void convert(const Pixels& newContent,
 			const Pixels& newMask);
+		virtual void convertInto(uint8_t *pixels, uint8_t *mask, size_t stride)
+			const;
 
 	protected:
-		/// Common code between convert() and convert_mask()
-		Pixels extractPortion(const Pixels& source) const;
+		/// Common code between the pixel and mask halves of convertInto()
+		void extractPortion(const Pixels& source, uint8_t *dest, size_t stride)
+			const;
 
 		std::shared_ptr<Pixels> stdImg;     ///< Pixel data cache
 		std::shared_ptr<Pixels> stdMask; ///< Pixel data cache for mask
@@ -99,6 +116,8 @@ class CAMOTO_GAMEGRAPHICS_API Image_Sub: virtual public Image
 		Rect dimsViewport;
 		ColourDepth depth;
 		std::shared_ptr<const Palette> pal;
+		bool hasHotspot;                 ///< Was a hotspot supplied?
+		Point ptHotspot;
 		fn_image_changed fnImageChanged; ///< Called to flag a change
 };
 
@@ -18,12 +18,30 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
 #include <cassert>
+#include <cstring>
+#include <camoto/util.hpp> // createString
 #include <camoto/gamegraphics/image.hpp>
+#include "content-hash.hpp"
+
+/// Size of each block read from the stream by Image::allSame()
+#define UNIFORM_BUFFER_SIZE 4096
 
 namespace camoto {
 namespace gamegraphics {
 
+unsigned int bitsPerPixel(ColourDepth depth)
+{
+	switch (depth) {
+		case ColourDepth::Mono: return 1;
+		case ColourDepth::CGA: return 2;
+		case ColourDepth::EGA: return 4;
+		case ColourDepth::VGA: return 8;
+	}
+	return 8;
+}
+
 Image::Image()
 {
 }
@@ -76,6 +94,576 @@ void Image::hitrect(const Point& newHitrect)
 		" (this is a bug - the caller should have used caps() to detect this).");
 }
 
+Pixels Image::convert() const
+{
+	auto dims = this->dimensions();
+	Pixels pixels(dims.x * dims.y, 0);
+	if (!pixels.empty()) this->convertInto(pixels.data(), nullptr, dims.x);
+	return pixels;
+}
+
+Pixels Image::convert_mask() const
+{
+	auto dims = this->dimensions();
+	Pixels mask(dims.x * dims.y, 0);
+	if (this->hasMask() && !mask.empty()) {
+		this->convertInto(nullptr, mask.data(), dims.x);
+	}
+	return mask;
+}
+
+Image::MaskKind Image::maskKind() const
+{
+	return MaskKind::Both;
+}
+
+bool Image::hasMask() const
+{
+	return this->maskKind() != MaskKind::Opaque;
+}
+
+SharedPixels Image::convertMaskShared() const
+{
+	if (!this->hasMask()) return Image::opaqueMask(this->dimensions());
+	return SharedPixels(this->convert_mask());
+}
+
+SharedPixels Image::opaqueMask(const Point& dims)
+{
+	// Each thread keeps only the most recent size it asked for, so there is no
+	// locking and at most one buffer per thread is kept alive.  Older sizes are
+	// freed once the last image using them lets go.
+	static thread_local SharedPixels mask;
+
+	size_t len = dims.x * dims.y;
+	if (mask.size() != len) mask = SharedPixels(Pixels(len, 0x00));
+	return mask;
+}
+
+Pixels Image::convert(const Rect& region) const
+{
+	this->checkRegion(region);
+	auto dims = this->dimensions();
+	auto full = this->convert();
+
+	Pixels pixels(region.width * region.height);
+	auto src = full.data() + region.y * dims.x + region.x;
+	auto dst = pixels.data();
+	for (long y = 0; y < region.height; y++) {
+		memcpy(dst, src, region.width);
+		src += dims.x;
+		dst += region.width;
+	}
+	return pixels;
+}
+
+void Image::convert(const Rect& region, const Pixels& newContent,
+	const Pixels& newMask)
+{
+	this->checkRegion(region);
+	auto dims = this->dimensions();
+	Pixels pixels, mask;
+	this->convertBoth(pixels, mask);
+
+	auto src = newContent.data();
+	auto srcMask = newMask.data();
+	for (long y = 0; y < region.height; y++) {
+		auto off = (region.y + y) * dims.x + region.x;
+		memcpy(&pixels[off], src, region.width);
+		memcpy(&mask[off], srcMask, region.width);
+		src += region.width;
+		srcMask += region.width;
+	}
+	this->convert(std::move(pixels), std::move(mask));
+	return;
+}
+
+Pixels Image::convertPreview(unsigned int shift) const
+{
+	auto dimsPreview = this->previewDimensions(shift);
+	Pixels pixels(dimsPreview.x * dimsPreview.y);
+	if (pixels.empty()) return pixels;
+
+	long step = 1L << shift;
+	this->decodeRows([&pixels, dimsPreview, shift, step](long y,
+		const uint8_t *rowPixels, const uint8_t *rowMask) {
+		if (y % step) return;
+		auto dst = &pixels[(y >> shift) * dimsPreview.x];
+		for (long x = 0; x < dimsPreview.x; x++) {
+			dst[x] = rowPixels[x << shift];
+		}
+	});
+	return pixels;
+}
+
+Point Image::previewDimensions(unsigned int shift) const
+{
+	auto dims = this->dimensions();
+	long step = 1L << shift;
+	return {(dims.x + step - 1) >> shift, (dims.y + step - 1) >> shift};
+}
+
+void Image::convertBoth(Pixels& pixels, Pixels& mask) const
+{
+	auto dims = this->dimensions();
+	pixels.assign(dims.x * dims.y, 0);
+	mask.assign(dims.x * dims.y, 0);
+	if (!pixels.empty()) this->convertInto(pixels.data(), mask.data(), dims.x);
+	return;
+}
+
+bool Image::isUniform(uint8_t *colour, uint8_t *mask) const
+{
+	SharedPixels pixels, maskData;
+	this->convertBothShared(pixels, maskData);
+	if (pixels.empty()) return false;
+	if (
+		!Image::allSame(pixels.data(), pixels.size())
+		|| !Image::allSame(maskData.data(), maskData.size())
+	) {
+		return false;
+	}
+	if (colour) *colour = pixels.data()[0];
+	if (mask) *mask = maskData.data()[0];
+	return true;
+}
+
+SharedPixels Image::convertShared() const
+{
+	return SharedPixels(this->convert());
+}
+
+void Image::convertBothShared(SharedPixels& pixels, SharedPixels& mask) const
+{
+	if (!this->hasMask()) {
+		pixels = this->convertShared();
+		mask = Image::opaqueMask(this->dimensions());
+		return;
+	}
+	Pixels newPixels, newMask;
+	this->convertBoth(newPixels, newMask);
+	pixels = SharedPixels(std::move(newPixels));
+	mask = SharedPixels(std::move(newMask));
+	return;
+}
+
+void Image::convert(Pixels&& newContent, Pixels&& newMask)
+{
+	const Pixels& constContent = newContent;
+	const Pixels& constMask = newMask;
+	this->convert(constContent, constMask);
+	return;
+}
+
+stream::len Image::encodedSize(const Pixels& newContent,
+	const Pixels& newMask) const
+{
+	throw stream::error("This image format can't calculate its encoded size"
+		" without writing the image.");
+}
+
+void Image::flipH()
+{
+	auto dims = this->dimensions();
+	Pixels pixels, mask;
+	this->convertBoth(pixels, mask);
+	for (long y = 0; y < dims.y; y++) {
+		std::reverse(pixels.begin() + y * dims.x, pixels.begin() + (y + 1) * dims.x);
+		std::reverse(mask.begin() + y * dims.x, mask.begin() + (y + 1) * dims.x);
+	}
+	this->convert(std::move(pixels), std::move(mask));
+	return;
+}
+
+void Image::flipV()
+{
+	auto dims = this->dimensions();
+	Pixels pixels, mask;
+	this->convertBoth(pixels, mask);
+	for (long y = 0; y < dims.y / 2; y++) {
+		std::swap_ranges(pixels.begin() + y * dims.x,
+			pixels.begin() + (y + 1) * dims.x,
+			pixels.begin() + (dims.y - 1 - y) * dims.x);
+		std::swap_ranges(mask.begin() + y * dims.x,
+			mask.begin() + (y + 1) * dims.x,
+			mask.begin() + (dims.y - 1 - y) * dims.x);
+	}
+	this->convert(std::move(pixels), std::move(mask));
+	return;
+}
+
+void Image::rotate90()
+{
+	auto dims = this->dimensions();
+	if ((dims.x != dims.y) && !(this->caps() & Caps::SetDimensions)) {
+		throw stream::error("This image can't be rotated as it isn't square and "
+			"its dimensions can't be changed.");
+	}
+
+	Pixels pixels, mask;
+	this->convertBoth(pixels, mask);
+
+	// The top row becomes the right-hand column
+	Pixels newPixels(pixels.size()), newMask(mask.size());
+	for (long y = 0; y < dims.y; y++) {
+		for (long x = 0; x < dims.x; x++) {
+			auto dst = x * dims.y + (dims.y - 1 - y);
+			newPixels[dst] = pixels[y * dims.x + x];
+			newMask[dst] = mask[y * dims.x + x];
+		}
+	}
+
+	if (dims.x != dims.y) this->dimensions(Point{dims.y, dims.x});
+	this->convert(std::move(newPixels), std::move(newMask));
+	return;
+}
+
+void Image::crop(const Rect& region)
+{
+	this->checkRegion(region);
+	auto dims = this->dimensions();
+	bool resize = (region.width != dims.x) || (region.height != dims.y);
+	if (resize && !(this->caps() & Caps::SetDimensions)) {
+		throw stream::error("This image can't be cropped as its dimensions "
+			"can't be changed.");
+	}
+
+	Pixels pixels, mask;
+	this->convertBoth(pixels, mask);
+
+	Pixels newPixels(region.width * region.height);
+	Pixels newMask(region.width * region.height);
+	for (long y = 0; y < region.height; y++) {
+		auto src = (region.y + y) * dims.x + region.x;
+		std::copy_n(&pixels[src], region.width, &newPixels[y * region.width]);
+		std::copy_n(&mask[src], region.width, &newMask[y * region.width]);
+	}
+
+	if (resize) this->dimensions(Point{region.width, region.height});
+	this->convert(std::move(newPixels), std::move(newMask));
+	return;
+}
+
+void Image::decodeRows(fn_image_row fnRow) const
+{
+	auto dims = this->dimensions();
+	Pixels pixels, mask;
+	this->convertBoth(pixels, mask);
+	for (long y = 0; y < dims.y; y++) {
+		fnRow(y, &pixels[y * dims.x], &mask[y * dims.x]);
+	}
+	return;
+}
+
+Pixels Image::convertPacked() const
+{
+	auto bpp = bitsPerPixel(this->colourDepth());
+	if (bpp == 8) return this->convert();
+
+	auto dims = this->dimensions();
+	size_t lenRow = (dims.x * bpp + 7) / 8;
+	Pixels packed(lenRow * dims.y, 0);
+	if (packed.empty()) return packed;
+	this->decodeRows([&packed, lenRow, dims, bpp](long y, const uint8_t *rowPixels,
+		const uint8_t *rowMask) {
+		Image::packRow(&packed[y * lenRow], rowPixels, dims.x, bpp);
+	});
+	return packed;
+}
+
+void Image::convertMaskPacked(Pixels& transparent, Pixels& touch) const
+{
+	auto dims = this->dimensions();
+	size_t lenRow = (dims.x + 7) / 8;
+	transparent.assign(lenRow * dims.y, 0);
+	touch.assign(lenRow * dims.y, 0);
+	if (transparent.empty() || !this->hasMask()) return;
+	this->decodeRows([&transparent, &touch, lenRow, dims](long y,
+		const uint8_t *rowPixels, const uint8_t *rowMask) {
+		Image::packBits(&transparent[y * lenRow], rowMask, dims.x,
+			(uint8_t)Mask::Transparent);
+		Image::packBits(&touch[y * lenRow], rowMask, dims.x, (uint8_t)Mask::Touch);
+	});
+	return;
+}
+
+HitBitmap Image::hitBitmap() const
+{
+	HitBitmap hit;
+	hit.dims = this->dimensions();
+	hit.stride = (hit.dims.x + 63) / 64;
+	hit.bits.assign(hit.stride * hit.dims.y, 0);
+	if (hit.bits.empty()) return hit;
+
+	// Bits past the right edge of the image in the last word of each row
+	unsigned int lenLast = hit.dims.x % 64;
+	uint64_t lastWordMask = lenLast ? ~(~0ULL >> lenLast) : ~0ULL;
+
+	auto kind = this->maskKind();
+	if (kind == MaskKind::Opaque) {
+		// No transparent pixels, so the whole image is solid
+		for (long y = 0; y < hit.dims.y; y++) {
+			auto row = &hit.bits[y * hit.stride];
+			std::fill(row, row + hit.stride, ~0ULL);
+			row[hit.stride - 1] = lastWordMask;
+		}
+		return hit;
+	}
+
+	Pixels transparent, touch;
+	this->convertMaskPacked(transparent, touch);
+	bool useTouch = kind & MaskKind::Touch;
+	const Pixels& plane = useTouch ? touch : transparent;
+	uint64_t invert = useTouch ? 0 : ~0ULL;
+
+	size_t lenRow = (hit.dims.x + 7) / 8;
+	for (long y = 0; y < hit.dims.y; y++) {
+		auto src = &plane[y * lenRow];
+		auto row = &hit.bits[y * hit.stride];
+		for (size_t i = 0; i < lenRow; i++) {
+			row[i / 8] |= (uint64_t)src[i] << (56 - (i % 8) * 8);
+		}
+		for (size_t w = 0; w < hit.stride; w++) row[w] ^= invert;
+		row[hit.stride - 1] &= lastWordMask;
+	}
+	return hit;
+}
+
+Rect Image::opaqueBounds() const
+{
+	auto dims = this->dimensions();
+	if (!(this->maskKind() & MaskKind::Transparent)) {
+		return {0, 0, dims.x, dims.y};
+	}
+
+	Pixels transparent, touch;
+	this->convertMaskPacked(transparent, touch);
+	if (transparent.empty()) return {0, 0, 0, 0};
+
+	// Bits past the right edge of the image in the last byte of each row
+	size_t lenRow = (dims.x + 7) / 8;
+	uint8_t lastByteMask = (dims.x % 8) ? (0xFF << (8 - dims.x % 8)) : 0xFF;
+
+	// OR the opaque pixels of every row together, which leaves the left and
+	// right edges as the first and last bits set.  Whole 64-bit words are
+	// done first, as the bytes don't need to be looked at individually until
+	// the edges are searched for at the end.
+	Pixels columns(lenRow, 0);
+	size_t lenWords = (lenRow - 1) / 8; // words before the padded last byte
+	long top = -1, bottom = -1;
+	for (long y = 0; y < dims.y; y++) {
+		auto row = &transparent[y * lenRow];
+		uint64_t anyWord = 0;
+		for (size_t w = 0; w < lenWords; w++) {
+			// Rows aren't word aligned, so let the compiler pick the best load
+			uint64_t opaque, col;
+			memcpy(&opaque, row + w * 8, 8);
+			memcpy(&col, &columns[w * 8], 8);
+			opaque = ~opaque;
+			col |= opaque;
+			anyWord |= opaque;
+			memcpy(&columns[w * 8], &col, 8);
+		}
+		uint8_t any = anyWord ? 1 : 0;
+		for (size_t i = lenWords * 8; i + 1 < lenRow; i++) {
+			uint8_t opaque = ~row[i];
+			columns[i] |= opaque;
+			any |= opaque;
+		}
+		// Leave out the padding at the end of the row
+		uint8_t opaque = ~row[lenRow - 1] & lastByteMask;
+		columns[lenRow - 1] |= opaque;
+		any |= opaque;
+		if (any) {
+			if (top < 0) top = y;
+			bottom = y;
+		}
+	}
+	if (top < 0) return {0, 0, 0, 0};
+
+	long left = 0, right = 0;
+	for (size_t i = 0; i < lenRow; i++) {
+		if (columns[i]) {
+			left = i * 8;
+			for (uint8_t c = columns[i]; !(c & 0x80); c <<= 1) left++;
+			break;
+		}
+	}
+	for (size_t i = lenRow; i > 0; i--) {
+		if (columns[i - 1]) {
+			right = i * 8;
+			for (uint8_t c = columns[i - 1]; !(c & 0x01); c >>= 1) right--;
+			break;
+		}
+	}
+	return {left, top, right - left, bottom - top + 1};
+}
+
+std::shared_ptr<const ImageSnapshot> Image::snapshot() const
+{
+	auto snap = std::make_shared<ImageSnapshot>();
+	snap->caps = this->caps();
+	snap->colourDepth = this->colourDepth();
+	snap->dimensions = this->dimensions();
+	this->convertBoth(snap->pixels, snap->mask);
+	snap->hotspot = (snap->caps & Caps::HasHotspot)
+		? this->hotspot() : Point{0, 0};
+	snap->hitrect = (snap->caps & Caps::HasHitRect)
+		? this->hitrect() : Point{0, 0};
+	if (snap->caps & Caps::HasPalette) snap->palette = this->palette();
+	return snap;
+}
+
+uint64_t Image::contentHash() const
+{
+	auto dims = this->dimensions();
+	ContentHash hash(ContentHash::Domain::Decoded, dims);
+	this->decodeRows([&hash, dims](long y, const uint8_t *rowPixels,
+		const uint8_t *rowMask) {
+		hash.add(rowPixels, dims.x);
+		hash.add(rowMask, dims.x);
+	});
+	return hash.value();
+}
+
+std::future<Pixels> Image::convertAsync(Executor& exec) const
+{
+	return submitTask<Pixels>(exec, [this]() {
+		return this->convert();
+	});
+}
+
+void Image::checkRegion(const Rect& region) const
+{
+	auto dims = this->dimensions();
+	if (
+		(region.x < 0) || (region.y < 0)
+		|| (region.width < 0) || (region.height < 0)
+		|| (region.x + region.width > dims.x)
+		|| (region.y + region.height > dims.y)
+	) {
+		throw stream::error(createString("Region " << region.width << "x"
+			<< region.height << " at (" << region.x << "," << region.y
+			<< ") does not fit within the " << dims.x << "x" << dims.y
+			<< " image."));
+	}
+	return;
+}
+
+void Image::copyRows(uint8_t *dst, size_t stride, const Point& dims,
+	const uint8_t *src)
+{
+	if (stride == (size_t)dims.x) {
+		memcpy(dst, src, dims.x * dims.y);
+		return;
+	}
+	for (long y = 0; y < dims.y; y++) {
+		memcpy(dst, src, dims.x);
+		dst += stride;
+		src += dims.x;
+	}
+	return;
+}
+
+void Image::fillRows(uint8_t *dst, size_t stride, const Point& dims,
+	uint8_t value)
+{
+	if (stride == (size_t)dims.x) {
+		memset(dst, value, dims.x * dims.y);
+		return;
+	}
+	for (long y = 0; y < dims.y; y++) {
+		memset(dst, value, dims.x);
+		dst += stride;
+	}
+	return;
+}
+
+Image::MaskKind Image::usedMaskKind(const uint8_t *mask, size_t stride,
+	const Point& dims)
+{
+	uint8_t bits = 0;
+	for (long y = 0; y < dims.y; y++) {
+		auto row = mask + y * stride;
+		for (long x = 0; x < dims.x; x++) bits |= row[x];
+		// No need to keep looking once every bit has been seen
+		if ((bits & (uint8_t)MaskKind::Both) == (uint8_t)MaskKind::Both) break;
+	}
+	return (MaskKind)(bits & (uint8_t)MaskKind::Both);
+}
+
+bool Image::allSame(const uint8_t *data, size_t len)
+{
+	// Comparing the buffer against itself shifted by one byte means every byte
+	// is compared with the next, using the library's optimised memcmp().
+	return (len < 2) || (memcmp(data, data + 1, len - 1) == 0);
+}
+
+bool Image::allSame(stream::input& content, stream::pos offset,
+	stream::len len, uint8_t *value)
+{
+	uint8_t buffer[UNIFORM_BUFFER_SIZE];
+	content.seekg(offset, stream::start);
+	content.read(value, 1);
+	buffer[0] = *value;
+	len--;
+
+	// Each block starts with the last byte of the previous one, so the first
+	// byte is compared against all the others.
+	while (len) {
+		stream::len lenBlock = std::min<stream::len>(len, sizeof(buffer) - 1);
+		content.read(buffer + 1, lenBlock);
+		if (!Image::allSame(buffer, lenBlock + 1)) return false;
+		buffer[0] = buffer[lenBlock];
+		len -= lenBlock;
+	}
+	return true;
+}
+
+void Image::packRow(uint8_t *dst, const uint8_t *src, long width,
+	unsigned int bpp)
+{
+	uint8_t valueMask = (1 << bpp) - 1;
+	uint8_t c = 0;
+	unsigned int shift = 8;
+	for (long x = 0; x < width; x++) {
+		shift -= bpp;
+		c |= (src[x] & valueMask) << shift;
+		if (shift == 0) {
+			*dst++ = c;
+			c = 0;
+			shift = 8;
+		}
+	}
+	// Write out any partial byte at the end of the row
+	if (shift != 8) *dst = c;
+	return;
+}
+
+void Image::packBits(uint8_t *dst, const uint8_t *src, long width,
+	uint8_t bit)
+{
+	for (long x = 0; x < width; x += 8) {
+		uint8_t c = 0;
+		long end = std::min(width, x + 8);
+		for (long b = x; b < end; b++) {
+			if (src[b] & bit) c |= 0x80 >> (b - x);
+		}
+		*dst++ = c;
+	}
+	return;
+}
+
+void Image::dropCache()
+{
+	return;
+}
+
+void Image::cacheDecoded(bool keep)
+{
+	return;
+}
+
 std::shared_ptr<const Palette> Image::palette() const
 {
 	return this->pal;
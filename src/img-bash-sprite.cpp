@@ -143,16 +143,12 @@ void Image_BashSprite::hitrect(const Point& newHitRect)
 	return;
 }
 
-Pixels Image_BashSprite::convert() const
+void Image_BashSprite::convertInto(uint8_t *pixels, uint8_t *mask,
+	size_t stride) const
 {
-	std::shared_ptr<Image> ega = this->toEGA();
-	return ega->convert();
-}
-
-Pixels Image_BashSprite::convert_mask() const
-{
-	std::shared_ptr<Image> ega = this->toEGA();
-	return ega->convert_mask();
+	auto ega = this->toEGA();
+	ega->convertInto(pixels, mask, stride);
+	return;
 }
 
 void Image_BashSprite::convert(const Pixels& newContent, const Pixels& newMask)
@@ -42,10 +42,11 @@ class CAMOTO_GAMEGRAPHICS_API Image_BashSprite: virtual public Image
 		virtual void hotspot(const Point& newHotspot);
 		virtual Point hitrect() const;
 		virtual void hitrect(const Point& newHitRect);
-		virtual Pixels convert() const;
-		virtual Pixels convert_mask() const;
+		using Image::convert;
 		virtual void convert(const Pixels& newContent,
 			const Pixels& newMask);
+		virtual void convertInto(uint8_t *pixels, uint8_t *mask, size_t stride)
+			const;
 
 	protected:
 		std::unique_ptr<stream::inout> content;
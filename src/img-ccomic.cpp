@@ -24,6 +24,7 @@
 #include "filter-ccomic.hpp"
 #include "img-ccomic.hpp"
 #include "img-ega-planar.hpp"
+#include "stream-count.hpp"
 
 /// Width of image, in pixels
 #define CCIMG_WIDTH 320
@@ -34,6 +35,22 @@
 namespace camoto {
 namespace gamegraphics {
 
+/// Captain Comic full-screen Image implementation.
+/**
+ * The image itself is handled by Image_EGA_Planar working on the decompressed
+ * data, this only adds the ability to work out the compressed size.
+ */
+class Image_CComic: public Image_EGA_Planar
+{
+	public:
+		Image_CComic(std::unique_ptr<stream::inout> content,
+			EGAPlaneLayout planes);
+		virtual ~Image_CComic();
+
+		virtual stream::len encodedSize(const Pixels& newContent,
+			const Pixels& newMask) const;
+};
+
 ImageType_CComic::ImageType_CComic()
 {
 }
@@ -142,10 +159,7 @@ std::unique_ptr<Image> ImageType_CComic::open(
 		EGAPlanePurpose::Unused,
 	};
 
-	return std::make_unique<Image_EGA_Planar>(
-		std::move(content_filtered), 0, Point{CCIMG_WIDTH, CCIMG_HEIGHT}, planes,
-		nullptr
-	);
+	return std::make_unique<Image_CComic>(std::move(content_filtered), planes);
 }
 
 SuppFilenames ImageType_CComic::getRequiredSupps(stream::input& content,
@@ -154,5 +168,35 @@ SuppFilenames ImageType_CComic::getRequiredSupps(stream::input& content,
 	return {};
 }
 
+Image_CComic::Image_CComic(std::unique_ptr<stream::inout> content,
+	EGAPlaneLayout planes)
+	:	Image_EGA_Planar(std::move(content), 0, Point{CCIMG_WIDTH, CCIMG_HEIGHT},
+			planes, nullptr)
+{
+}
+
+Image_CComic::~Image_CComic()
+{
+}
+
+stream::len Image_CComic::encodedSize(const Pixels& newContent,
+	const Pixels& newMask) const
+{
+	// Write the image out again through the RLE filter, but into a stream that
+	// only counts the compressed bytes rather than storing them.
+	auto counter = std::make_shared<stream_count>();
+	Image_EGA_Planar dryRun(
+		std::make_unique<stream::filtered>(
+			counter,
+			std::make_shared<filter_ccomic_unrle>(),
+			std::make_shared<filter_ccomic_rle>(),
+			nullptr
+		),
+		0, this->dims, this->planes, nullptr
+	);
+	dryRun.convert(newContent, newMask);
+	return counter->size();
+}
+
 } // namespace gamegraphics
 } // namespace camoto
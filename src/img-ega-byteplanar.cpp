@@ -18,6 +18,7 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
 #include <iostream>
 #include <cstring>  // memset
 #include <cassert>
@@ -41,6 +42,7 @@ Image_EGA_BytePlanar::~Image_EGA_BytePlanar()
 void Image_EGA_BytePlanar::convert(const Pixels& newContent,
 	const Pixels& newMask)
 {
+	this->cache.invalidate();
 	this->content->seekp(this->offset, stream::start);
 	auto dims = this->dimensions();
 
@@ -56,24 +58,9 @@ void Image_EGA_BytePlanar::convert(const Pixels& newContent,
 			for (auto p : this->planes) {
 				if (p == EGAPlanePurpose::Unused) break;
 
-				bool doMask = false, swap = false;
-				uint8_t value = 0;
-				switch (p) {
-					case EGAPlanePurpose::Unused: continue;
-					case EGAPlanePurpose::Blank:      doMask = false; value = 0x00; swap = false; break;
-					case EGAPlanePurpose::Blue0:      doMask = false; value = 0x01; swap = true;  break;
-					case EGAPlanePurpose::Blue1:      doMask = false; value = 0x01; swap = false; break;
-					case EGAPlanePurpose::Green0:     doMask = false; value = 0x02; swap = true;  break;
-					case EGAPlanePurpose::Green1:     doMask = false; value = 0x02; swap = false; break;
-					case EGAPlanePurpose::Red0:       doMask = false; value = 0x04; swap = true;  break;
-					case EGAPlanePurpose::Red1:       doMask = false; value = 0x04; swap = false; break;
-					case EGAPlanePurpose::Intensity0: doMask = false; value = 0x08; swap = true;  break;
-					case EGAPlanePurpose::Intensity1: doMask = false; value = 0x08; swap = false; break;
-					case EGAPlanePurpose::Hit0:       doMask = true;  value = (uint8_t)Mask::Touch;       swap = true;  break;
-					case EGAPlanePurpose::Hit1:       doMask = true;  value = (uint8_t)Mask::Touch;       swap = false; break;
-					case EGAPlanePurpose::Opaque0:    doMask = true;  value = (uint8_t)Mask::Transparent; swap = false; break;
-					case EGAPlanePurpose::Opaque1:    doMask = true;  value = (uint8_t)Mask::Transparent; swap = true;  break;
-				}
+				bool doMask, swap;
+				uint8_t value;
+				Image_EGA::planeInfo(p, doMask, value, swap);
 
 				// Work out if this plane will read from the input image or mask data.
 				auto rowData = doMask ? maskData : imgData;
@@ -106,42 +93,58 @@ void Image_EGA_BytePlanar::convert(const Pixels& newContent,
 	return;
 }
 
-void Image_EGA_BytePlanar::doConversion()
+bool Image_EGA_BytePlanar::isUniform(uint8_t *colour, uint8_t *mask) const
+{
+	auto dims = this->dimensions();
+	unsigned int numPlanes = 0;
+	for (auto p : this->planes) {
+		if (p == EGAPlanePurpose::Unused) break;
+		numPlanes++;
+	}
+
+	// Partial cells have padding bits, and blank planes can hold anything, so
+	// in both cases the bytes can't be compared as a whole.
+	if (
+		this->cache.valid() || (dims.x % 8) || (dims.x == 0) || (dims.y == 0)
+		|| (numPlanes == 0) || this->hasBlankPlanes(numPlanes)
+	) {
+		return this->Image_EGA::isUniform(colour, mask);
+	}
+
+	stream::len len = this->lenData();
+	ArenaPixels data(len);
+	this->content->seekg(this->offset, stream::start);
+	this->content->read(data.data(), len);
+
+	// Each cell is one byte from each plane in turn, so the image is uniform if
+	// every cell matches the one before it and the planes are solid.
+	if (memcmp(data.data(), data.data() + numPlanes, len - numPlanes) != 0) {
+		return false;
+	}
+	std::vector<uint8_t> planeBytes(data.begin(), data.begin() + numPlanes);
+	return this->uniformPixel(planeBytes, colour, mask);
+}
+
+void Image_EGA_BytePlanar::doConversion(uint8_t *pixels, uint8_t *mask,
+	size_t stride)
 {
 	this->content->seekg(this->offset, stream::start);
 
 	auto dims = this->dimensions();
-	this->pixels = Pixels(dims.x * dims.y, '\x00');
-	this->mask = Pixels(dims.x * dims.y, '\x00');
 
-	auto imgData = &this->pixels[0];
-	auto maskData = &this->mask[0];
 	for (unsigned int y = 0; y < dims.y; y++) {
 		// Run through each lot of eight pixels (a "cell"), including a partial
 		// cell at the end if the width isn't a multiple of 8.
 		for (unsigned int x = 0; x < dims.x; x += 8) {
+			auto imgData = pixels ? pixels + y * stride + x : nullptr;
+			auto maskData = mask ? mask + y * stride + x : nullptr;
 
 			for (auto p : this->planes) {
 				if (p == EGAPlanePurpose::Unused) break;
 
-				bool doMask = false, swap = false;
-				uint8_t value = 0;
-				switch (p) {
-					case EGAPlanePurpose::Unused: continue;
-					case EGAPlanePurpose::Blank:      doMask = false; value = 0x00; swap = false; break;
-					case EGAPlanePurpose::Blue0:      doMask = false; value = 0x01; swap = true;  break;
-					case EGAPlanePurpose::Blue1:      doMask = false; value = 0x01; swap = false; break;
-					case EGAPlanePurpose::Green0:     doMask = false; value = 0x02; swap = true;  break;
-					case EGAPlanePurpose::Green1:     doMask = false; value = 0x02; swap = false; break;
-					case EGAPlanePurpose::Red0:       doMask = false; value = 0x04; swap = true;  break;
-					case EGAPlanePurpose::Red1:       doMask = false; value = 0x04; swap = false; break;
-					case EGAPlanePurpose::Intensity0: doMask = false; value = 0x08; swap = true;  break;
-					case EGAPlanePurpose::Intensity1: doMask = false; value = 0x08; swap = false; break;
-					case EGAPlanePurpose::Hit0:       doMask = true;  value = (uint8_t)Mask::Touch;       swap = true;  break;
-					case EGAPlanePurpose::Hit1:       doMask = true;  value = (uint8_t)Mask::Touch;       swap = false; break;
-					case EGAPlanePurpose::Opaque0:    doMask = true;  value = (uint8_t)Mask::Transparent; swap = false; break;
-					case EGAPlanePurpose::Opaque1:    doMask = true;  value = (uint8_t)Mask::Transparent; swap = true;  break;
-				}
+				bool doMask, swap;
+				uint8_t value;
+				Image_EGA::planeInfo(p, doMask, value, swap);
 
 				uint8_t nextByte;
 				try {
@@ -152,21 +155,13 @@ void Image_EGA_BytePlanar::doConversion()
 					return;
 				}
 
-				// See which bit we should read down to (starting at 7.)  This is only
-				// used when the image is not an even multiple of 8.
-				int bits = 0;
-				if (x + 8 > dims.x) bits = 8 - (dims.x % 8);
-
-				// Run through all the (valid) bits in this byte
+				// Decode all the (valid) bits in this byte, which is fewer than eight
+				// in the last cell if the image is not an even multiple of 8.
 				auto rowData = doMask ? maskData : imgData;
-				for (int b = 7; b >= bits; b--) {
-					*rowData++ |= (((nextByte >> b) & 1) ^ swap) ? value : 0x00;
-				}
+				if (!rowData) continue; // caller doesn't want this plane
+				this->decodePlaneRow(rowData, &nextByte,
+					std::min<long>(8, dims.x - x), value, swap);
 			}
-			int lenCell = 8;
-			if (x + 8 > dims.x) lenCell = dims.x - x;
-			imgData += lenCell;
-			maskData += lenCell;
 		}
 	}
 	return;
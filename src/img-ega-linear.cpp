@@ -35,9 +35,103 @@ Image_EGA_Linear::~Image_EGA_Linear()
 {
 }
 
+Pixels Image_EGA_Linear::convertPacked() const
+{
+	// Use the cache if the whole image has already been decoded
+	if (this->cache.valid()) return this->Image::convertPacked();
+
+	auto dims = this->dimensions();
+	unsigned int bpp = bitsPerPixel(this->colourDepth());
+	uint8_t valueMask = (1 << bpp) - 1;
+	unsigned int lenPackedRow = (dims.x * bpp + 7) / 8;
+	Pixels packed(lenPackedRow * dims.y, '\x00');
+	if (packed.empty()) return packed;
+
+	auto noconst_this = const_cast<Image_EGA_Linear*>(this);
+	auto& bits = noconst_this->bits;
+	bits.seek(this->offset * 8, stream::start);
+	for (unsigned int y = 0; y < dims.y; y++) {
+		auto rowData = &packed[y * lenPackedRow];
+		for (unsigned int x = 0; x < dims.x; x++) {
+			// The leftmost pixel goes in the most significant bits
+			unsigned int shift = 8 - bpp - (x * bpp) % 8;
+			for (auto p : this->planes) {
+				if (p == EGAPlanePurpose::Unused) break;
+
+				unsigned int bit;
+				bits.read(1, &bit);
+				bool doMask, swap;
+				uint8_t value;
+				Image_EGA::planeInfo(p, doMask, value, swap);
+
+				// Mask planes are not included in the packed data
+				if (doMask) continue;
+
+				if (swap) bit ^= 1;
+
+				if (bit) rowData[x * bpp / 8] |= (value & valueMask) << shift;
+			}
+		}
+		// Always start each row on a byte boundary
+		bits.flushByte();
+	}
+	return packed;
+}
+
+void Image_EGA_Linear::convertMaskPacked(Pixels& transparent, Pixels& touch)
+	const
+{
+	// Use the cache if the whole image has already been decoded, or skip the
+	// read if there are no mask planes.
+	if (this->cache.valid() || !this->hasMaskPlanes()) {
+		this->Image_EGA::convertMaskPacked(transparent, touch);
+		return;
+	}
+
+	auto dims = this->dimensions();
+	unsigned int lenRow = (dims.x + 7) / 8;
+	transparent.assign(lenRow * dims.y, '\x00');
+	touch.assign(lenRow * dims.y, '\x00');
+
+	auto noconst_this = const_cast<Image_EGA_Linear*>(this);
+	auto& bits = noconst_this->bits;
+	bits.seek(this->offset * 8, stream::start);
+	for (unsigned int y = 0; y < dims.y; y++) {
+		auto rowTransparent = &transparent[y * lenRow];
+		auto rowTouch = &touch[y * lenRow];
+		for (unsigned int x = 0; x < dims.x; x++) {
+			uint8_t cellBit = 0x80 >> (x % 8);
+			for (auto p : this->planes) {
+				if (p == EGAPlanePurpose::Unused) break;
+
+				unsigned int bit;
+				bits.read(1, &bit);
+				bool doMask, swap;
+				uint8_t value;
+				Image_EGA::planeInfo(p, doMask, value, swap);
+
+				// Colour planes are not included in the mask
+				if (!doMask) continue;
+
+				if (swap) bit ^= 1;
+
+				if (bit) {
+					auto rowData = (value == (uint8_t)Mask::Touch)
+						? rowTouch : rowTransparent;
+					rowData[x / 8] |= cellBit;
+				}
+			}
+		}
+		// Always start each row on a byte boundary
+		bits.flushByte();
+	}
+	return;
+}
+
 void Image_EGA_Linear::convert(const Pixels& newContent,
 	const Pixels& newMask)
 {
+	this->cache.invalidate();
 	this->bits.seek(this->offset * 8, stream::start);
 
 	auto dims = this->dimensions();
@@ -52,24 +146,9 @@ void Image_EGA_Linear::convert(const Pixels& newContent,
 				// Don't waste time processing a plane we're ignoring
 				if (p == EGAPlanePurpose::Unused) break;
 
-				bool doMask = false, swap = false;
-				uint8_t value = 0;
-				switch (p) {
-					case EGAPlanePurpose::Unused: continue;
-					case EGAPlanePurpose::Blank:      doMask = false; value = 0x00; swap = false; break;
-					case EGAPlanePurpose::Blue0:      doMask = false; value = 0x01; swap = true;  break;
-					case EGAPlanePurpose::Blue1:      doMask = false; value = 0x01; swap = false; break;
-					case EGAPlanePurpose::Green0:     doMask = false; value = 0x02; swap = true;  break;
-					case EGAPlanePurpose::Green1:     doMask = false; value = 0x02; swap = false; break;
-					case EGAPlanePurpose::Red0:       doMask = false; value = 0x04; swap = true;  break;
-					case EGAPlanePurpose::Red1:       doMask = false; value = 0x04; swap = false; break;
-					case EGAPlanePurpose::Intensity0: doMask = false; value = 0x08; swap = true;  break;
-					case EGAPlanePurpose::Intensity1: doMask = false; value = 0x08; swap = false; break;
-					case EGAPlanePurpose::Hit0:       doMask = true;  value = (uint8_t)Mask::Touch;       swap = true;  break;
-					case EGAPlanePurpose::Hit1:       doMask = true;  value = (uint8_t)Mask::Touch;       swap = false; break;
-					case EGAPlanePurpose::Opaque0:    doMask = true;  value = (uint8_t)Mask::Transparent; swap = false;  break;
-					case EGAPlanePurpose::Opaque1:    doMask = true;  value = (uint8_t)Mask::Transparent; swap = true; break;
-				}
+				bool doMask, swap;
+				uint8_t value;
+				Image_EGA::planeInfo(p, doMask, value, swap);
 
 				auto rowData = doMask ? maskData : imgData;
 
@@ -90,17 +169,31 @@ void Image_EGA_Linear::convert(const Pixels& newContent,
 	return;
 }
 
-void Image_EGA_Linear::doConversion()
+stream::len Image_EGA_Linear::lenData() const
+{
+	auto dims = this->dimensions();
+
+	unsigned int numPlanes = 0;
+	for (auto p : this->planes) {
+		if (p == EGAPlanePurpose::Unused) break;
+		numPlanes++;
+	}
+
+	// The bits for all planes are packed together, with each row starting on
+	// a byte boundary
+	return ((dims.x * numPlanes + 7) / 8) * dims.y;
+}
+
+void Image_EGA_Linear::doConversion(uint8_t *pixels, uint8_t *mask,
+	size_t stride)
 {
 	this->bits.seek(this->offset * 8, stream::start);
 
 	auto dims = this->dimensions();
-	this->pixels = Pixels(dims.x * dims.y, '\x00');
-	this->mask = Pixels(dims.x * dims.y, '\x00');
 
-	auto imgData = &this->pixels[0];
-	auto maskData = &this->mask[0];
 	for (unsigned int y = 0; y < dims.y; y++) {
+		auto imgData = pixels ? pixels + y * stride : nullptr;
+		auto maskData = mask ? mask + y * stride : nullptr;
 		// Run through each lot of eight pixels (a "cell"), including a partial
 		// cell at the end if the width isn't a multiple of 8.
 		for (unsigned int x = 0; x < dims.x; x++) {
@@ -110,33 +203,17 @@ void Image_EGA_Linear::doConversion()
 
 				unsigned int bit;
 				this->bits.read(1, &bit);
-				bool doMask = false, swap = false;
-				uint8_t value = 0;
-				switch (p) {
-					case EGAPlanePurpose::Unused: continue;
-					case EGAPlanePurpose::Blank:      doMask = false; value = 0x00; swap = false; break;
-					case EGAPlanePurpose::Blue0:      doMask = false; value = 0x01; swap = true;  break;
-					case EGAPlanePurpose::Blue1:      doMask = false; value = 0x01; swap = false; break;
-					case EGAPlanePurpose::Green0:     doMask = false; value = 0x02; swap = true;  break;
-					case EGAPlanePurpose::Green1:     doMask = false; value = 0x02; swap = false; break;
-					case EGAPlanePurpose::Red0:       doMask = false; value = 0x04; swap = true;  break;
-					case EGAPlanePurpose::Red1:       doMask = false; value = 0x04; swap = false; break;
-					case EGAPlanePurpose::Intensity0: doMask = false; value = 0x08; swap = true;  break;
-					case EGAPlanePurpose::Intensity1: doMask = false; value = 0x08; swap = false; break;
-					case EGAPlanePurpose::Hit0:       doMask = true;  value = (uint8_t)Mask::Touch;       swap = true;  break;
-					case EGAPlanePurpose::Hit1:       doMask = true;  value = (uint8_t)Mask::Touch;       swap = false; break;
-					case EGAPlanePurpose::Opaque0:    doMask = true;  value = (uint8_t)Mask::Transparent; swap = false;  break;
-					case EGAPlanePurpose::Opaque1:    doMask = true;  value = (uint8_t)Mask::Transparent; swap = true; break;
-				}
+				bool doMask, swap;
+				uint8_t value;
+				Image_EGA::planeInfo(p, doMask, value, swap);
 
 				auto rowData = doMask ? maskData : imgData;
+				if (!rowData) continue; // caller doesn't want this plane
 
 				if (swap) bit ^= 1;
 
-				if (bit) *rowData |= value;
+				if (bit) rowData[x] |= value;
 			}
-			imgData++;
-			maskData++;
 		}
 		// Always start each row on a byte boundary
 		this->bits.flushByte();
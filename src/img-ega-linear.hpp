@@ -44,11 +44,13 @@ class CAMOTO_GAMEGRAPHICS_API Image_EGA_Linear: public Image_EGA
 		virtual ~Image_EGA_Linear();
 
 		using Image_EGA::convert;
+		virtual Pixels convertPacked() const;
+		virtual void convertMaskPacked(Pixels& transparent, Pixels& touch) const;
 		virtual void convert(const Pixels& newContent, const Pixels& newMask);
 
 	protected:
-		/// Populate this->pixels and this->mask
-		virtual void doConversion();
+		virtual void doConversion(uint8_t *pixels, uint8_t *mask, size_t stride);
+		virtual stream::len lenData() const;
 
 		bitstream bits;
 };
@@ -18,6 +18,7 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
 #include <cstring>  // memset
 #include <cassert>
 #include <camoto/util.hpp> // make_unique
@@ -38,9 +39,214 @@ Image_EGA_Planar::~Image_EGA_Planar()
 {
 }
 
+Pixels Image_EGA_Planar::convert(const Rect& region) const
+{
+	this->checkRegion(region);
+
+	// Use the cache if the whole image has already been decoded
+	if (this->cache.valid()) return this->Image::convert(region);
+
+	Pixels pixels(region.width * region.height, '\x00');
+	if (pixels.empty()) return pixels;
+
+	auto dims = this->dimensions();
+	unsigned int lenRow = (dims.x + 7) / 8;
+	unsigned int planeSizeBytes = dims.y * lenRow;
+
+	// Only read the bytes in each row that cover the requested columns
+	unsigned int firstCell = region.x / 8;
+	unsigned int lenSpan = (region.x + region.width + 7) / 8 - firstCell;
+	ArenaPixels span(lenSpan);
+
+	stream::pos planeStart = this->offset;
+	for (auto p : this->planes) {
+		if (p == EGAPlanePurpose::Unused) continue;
+
+		bool doMask, swap;
+		uint8_t value;
+		Image_EGA::planeInfo(p, doMask, value, swap);
+
+		if ((p != EGAPlanePurpose::Blank) && (!doMask)) {
+			auto dst = pixels.data();
+			for (long y = 0; y < region.height; y++) {
+				this->content->seekg(planeStart + (region.y + y) * lenRow + firstCell,
+					stream::start);
+				try {
+					this->content->read(span.data(), lenSpan);
+				} catch (const stream::incomplete_read&) {
+					std::cerr << "ERROR: Incomplete read converting image to standard "
+						"format.  Returning partial conversion." << std::endl;
+					return pixels;
+				}
+				for (long x = region.x; x < region.x + region.width; x++) {
+					uint8_t bit = (span[x / 8 - firstCell] >> (7 - x % 8)) & 1;
+					*dst++ |= (bit ^ swap) ? value : 0x00;
+				}
+			}
+		}
+		planeStart += planeSizeBytes;
+	}
+	return pixels;
+}
+
+Pixels Image_EGA_Planar::convertPreview(unsigned int shift) const
+{
+	// Use the cache if the whole image has already been decoded
+	if (this->cache.valid()) return this->Image::convertPreview(shift);
+
+	auto dimsPreview = this->previewDimensions(shift);
+	Pixels pixels(dimsPreview.x * dimsPreview.y, '\x00');
+	if (pixels.empty()) return pixels;
+
+	auto dims = this->dimensions();
+	unsigned int lenRow = (dims.x + 7) / 8;
+	unsigned int planeSizeBytes = dims.y * lenRow;
+	ArenaPixels row(lenRow);
+
+	stream::pos planeStart = this->offset;
+	for (auto p : this->planes) {
+		if (p == EGAPlanePurpose::Unused) continue;
+
+		bool doMask, swap;
+		uint8_t value;
+		Image_EGA::planeInfo(p, doMask, value, swap);
+
+		if ((p != EGAPlanePurpose::Blank) && (!doMask)) {
+			// Only the sampled rows of each plane are read
+			auto dst = pixels.data();
+			for (long y = 0; y < dimsPreview.y; y++) {
+				this->content->seekg(planeStart + (y << shift) * lenRow,
+					stream::start);
+				try {
+					this->content->read(row.data(), lenRow);
+				} catch (const stream::incomplete_read&) {
+					std::cerr << "ERROR: Incomplete read converting image to standard "
+						"format.  Returning partial conversion." << std::endl;
+					return pixels;
+				}
+				for (long x = 0; x < dims.x; x += (1L << shift)) {
+					uint8_t bit = (row[x / 8] >> (7 - x % 8)) & 1;
+					*dst++ |= (bit ^ swap) ? value : 0x00;
+				}
+			}
+		}
+		planeStart += planeSizeBytes;
+	}
+	return pixels;
+}
+
+Pixels Image_EGA_Planar::convertPacked() const
+{
+	// Use the cache if the whole image has already been decoded
+	if (this->cache.valid()) return this->Image::convertPacked();
+
+	auto dims = this->dimensions();
+	unsigned int bpp = bitsPerPixel(this->colourDepth());
+	uint8_t valueMask = (1 << bpp) - 1;
+	unsigned int lenRow = (dims.x + 7) / 8;
+	unsigned int lenPackedRow = (dims.x * bpp + 7) / 8;
+	unsigned int planeSizeBytes = dims.y * lenRow;
+	Pixels packed(lenPackedRow * dims.y, '\x00');
+	if (packed.empty()) return packed;
+
+	ArenaPixels row(lenRow);
+	stream::pos planeStart = this->offset;
+	for (auto p : this->planes) {
+		if (p == EGAPlanePurpose::Unused) continue;
+
+		bool doMask, swap;
+		uint8_t value;
+		Image_EGA::planeInfo(p, doMask, value, swap);
+
+		// Only the colour planes end up in the packed data
+		if ((p != EGAPlanePurpose::Blank) && (!doMask)) {
+			this->content->seekg(planeStart, stream::start);
+			auto dst = packed.data();
+			for (long y = 0; y < dims.y; y++) {
+				try {
+					this->content->read(row.data(), lenRow);
+				} catch (const stream::incomplete_read&) {
+					std::cerr << "ERROR: Incomplete read converting image to standard "
+						"format.  Returning partial conversion." << std::endl;
+					return packed;
+				}
+				// Each plane supplies one bit of every pixel, with the leftmost
+				// pixel in the most significant bits.
+				for (long x = 0; x < dims.x; x++) {
+					uint8_t bit = (row[x / 8] >> (7 - x % 8)) & 1;
+					if (bit ^ swap) {
+						dst[x * bpp / 8] |=
+							(value & valueMask) << (8 - bpp - (x * bpp) % 8);
+					}
+				}
+				dst += lenPackedRow;
+			}
+		}
+		planeStart += planeSizeBytes;
+	}
+	return packed;
+}
+
+void Image_EGA_Planar::convertMaskPacked(Pixels& transparent, Pixels& touch)
+	const
+{
+	// Use the cache if the whole image has already been decoded, or skip the
+	// read if there are no mask planes.
+	if (this->cache.valid() || !this->hasMaskPlanes()) {
+		this->Image_EGA::convertMaskPacked(transparent, touch);
+		return;
+	}
+
+	auto dims = this->dimensions();
+	unsigned int lenRow = (dims.x + 7) / 8;
+	unsigned int planeSizeBytes = dims.y * lenRow;
+	transparent.assign(planeSizeBytes, '\x00');
+	touch.assign(planeSizeBytes, '\x00');
+	if (transparent.empty()) return;
+
+	// Bits past the right edge of the image in the last byte of each row
+	uint8_t lastByteMask = (dims.x % 8) ? (0xFF << (8 - dims.x % 8)) : 0xFF;
+
+	ArenaPixels row(lenRow);
+	stream::pos planeStart = this->offset;
+	for (auto p : this->planes) {
+		if (p == EGAPlanePurpose::Unused) continue;
+
+		bool doMask, swap;
+		uint8_t value;
+		Image_EGA::planeInfo(p, doMask, value, swap);
+
+		// The mask planes are already in the packed format, so they only need to
+		// be inverted where a 0 bit means the mask bit is set.
+		if (doMask) {
+			auto dst = (value == (uint8_t)Mask::Touch)
+				? touch.data() : transparent.data();
+			uint8_t invert = swap ? 0xFF : 0x00;
+			this->content->seekg(planeStart, stream::start);
+			for (long y = 0; y < dims.y; y++) {
+				try {
+					this->content->read(row.data(), lenRow);
+				} catch (const stream::incomplete_read&) {
+					std::cerr << "ERROR: Incomplete read converting image to standard "
+						"format.  Returning partial conversion." << std::endl;
+					return;
+				}
+				for (unsigned int i = 0; i < lenRow; i++) {
+					dst[i] |= row[i] ^ invert;
+				}
+				dst[lenRow - 1] &= lastByteMask;
+				dst += lenRow;
+			}
+		}
+		planeStart += planeSizeBytes;
+	}
+	return;
+}
+
 void Image_EGA_Planar::convert(const Pixels& newContent,
 	const Pixels& newMask)
 {
+	this->cache.invalidate();
 	this->content->seekp(this->offset, stream::start);
 	auto dims = this->dimensions();
 
@@ -51,24 +257,9 @@ void Image_EGA_Planar::convert(const Pixels& newContent,
 		// implement it if it ever becomes necessary.
 		if (p == EGAPlanePurpose::Unused) continue;
 
-		bool doMask = false, swap = false;
-		uint8_t value = 0;
-		switch (p) {
-			case EGAPlanePurpose::Unused: continue;
-			case EGAPlanePurpose::Blank:      doMask = false; value = 0x00; swap = false; break;
-			case EGAPlanePurpose::Blue0:      doMask = false; value = 0x01; swap = true;  break;
-			case EGAPlanePurpose::Blue1:      doMask = false; value = 0x01; swap = false; break;
-			case EGAPlanePurpose::Green0:     doMask = false; value = 0x02; swap = true;  break;
-			case EGAPlanePurpose::Green1:     doMask = false; value = 0x02; swap = false; break;
-			case EGAPlanePurpose::Red0:       doMask = false; value = 0x04; swap = true;  break;
-			case EGAPlanePurpose::Red1:       doMask = false; value = 0x04; swap = false; break;
-			case EGAPlanePurpose::Intensity0: doMask = false; value = 0x08; swap = true;  break;
-			case EGAPlanePurpose::Intensity1: doMask = false; value = 0x08; swap = false; break;
-			case EGAPlanePurpose::Hit0:       doMask = true;  value = (uint8_t)Mask::Touch;       swap = true;  break;
-			case EGAPlanePurpose::Hit1:       doMask = true;  value = (uint8_t)Mask::Touch;       swap = false; break;
-			case EGAPlanePurpose::Opaque0:    doMask = true;  value = (uint8_t)Mask::Transparent; swap = false;  break;
-			case EGAPlanePurpose::Opaque1:    doMask = true;  value = (uint8_t)Mask::Transparent; swap = true; break;
-		}
+		bool doMask, swap;
+		uint8_t value;
+		Image_EGA::planeInfo(p, doMask, value, swap);
 
 		// Work out if this plane will read from the input image or mask data.
 		auto rowData = doMask ? newMask.data() : newContent.data();
@@ -104,20 +295,165 @@ void Image_EGA_Planar::convert(const Pixels& newContent,
 	return;
 }
 
-void Image_EGA_Planar::doConversion()
+void Image_EGA_Planar::convert(const Rect& region, const Pixels& newContent,
+	const Pixels& newMask)
+{
+	this->checkRegion(region);
+
+	// Write out the whole image if it isn't there to be patched yet
+	if (this->content->size() < this->offset + this->lenData()) {
+		this->Image::convert(region, newContent, newMask);
+		return;
+	}
+	if ((region.width == 0) || (region.height == 0)) return;
+	this->cache.invalidate();
+
+	auto dims = this->dimensions();
+	unsigned int lenRow = (dims.x + 7) / 8;
+	unsigned int planeSizeBytes = dims.y * lenRow;
+
+	// Only the bytes in each row that cover the region are read and rewritten
+	unsigned int firstCell = region.x / 8;
+	unsigned int lenSpan = (region.x + region.width + 7) / 8 - firstCell;
+	ArenaPixels span(lenSpan);
+
+	stream::pos planeStart = this->offset;
+	for (auto p : this->planes) {
+		if (p == EGAPlanePurpose::Unused) continue;
+
+		bool doMask, swap;
+		uint8_t value;
+		Image_EGA::planeInfo(p, doMask, value, swap);
+
+		auto rowData = doMask ? newMask.data() : newContent.data();
+		for (long y = 0; y < region.height; y++) {
+			stream::pos offSpan = planeStart + (region.y + y) * lenRow + firstCell;
+			this->content->seekg(offSpan, stream::start);
+			this->content->read(span.data(), lenSpan);
+			for (long x = 0; x < region.width; x++) {
+				unsigned int px = region.x + x;
+				uint8_t bit = 0x80 >> (px % 8);
+				bool on = rowData[x] & value;
+				if (on ^ swap) span[px / 8 - firstCell] |= bit;
+				else span[px / 8 - firstCell] &= ~bit;
+			}
+			this->content->seekp(offSpan, stream::start);
+			this->content->write(span.data(), lenSpan);
+			rowData += region.width;
+		}
+		planeStart += planeSizeBytes;
+	}
+	this->content->flush();
+	return;
+}
+
+bool Image_EGA_Planar::isUniform(uint8_t *colour, uint8_t *mask) const
+{
+	auto dims = this->dimensions();
+
+	// Rows that don't fill their last byte have padding bits that aren't part
+	// of the image, so the bytes can't be compared as a whole.
+	if (
+		this->cache.valid() || (dims.x % 8) || (dims.x == 0) || (dims.y == 0)
+	) {
+		return this->Image_EGA::isUniform(colour, mask);
+	}
+
+	// Each plane is kept together, so every byte within it must be the same
+	unsigned int planeSizeBytes = dims.x / 8 * dims.y;
+	std::vector<uint8_t> planeBytes;
+	stream::pos planeStart = this->offset;
+	for (auto p : this->planes) {
+		if (p == EGAPlanePurpose::Unused) continue;
+		uint8_t value = 0x00;
+		if (p != EGAPlanePurpose::Blank) {
+			if (!Image::allSame(*this->content, planeStart, planeSizeBytes, &value)) {
+				return false;
+			}
+		}
+		planeBytes.push_back(value);
+		planeStart += planeSizeBytes;
+	}
+	return this->uniformPixel(planeBytes, colour, mask);
+}
+
+stream::len Image_EGA_Planar::lenData() const
+{
+	auto dims = this->dimensions();
+
+	// Unlike the other layouts, planes after an unused one are still written
+	unsigned int numPlanes = 0;
+	for (auto p : this->planes) {
+		if (p != EGAPlanePurpose::Unused) numPlanes++;
+	}
+
+	return numPlanes * ((dims.x + 7) / 8) * dims.y;
+}
+
+void Image_EGA_Planar::flipH()
+{
+	auto dims = this->dimensions();
+	if (dims.x % 8) {
+		// Partial bytes at the end of each row can't be mirrored in place
+		this->Image::flipH();
+		return;
+	}
+
+	unsigned int numPlanes = 0;
+	for (auto p : this->planes) {
+		if (p != EGAPlanePurpose::Unused) numPlanes++;
+	}
+	unsigned int lenRow = dims.x / 8;
+
+	this->rewriteData(numPlanes * lenRow * dims.y, [=](uint8_t *data) {
+		// Every row of every plane is mirrored the same way
+		Image_EGA::mirrorRows(data, numPlanes * dims.y, lenRow);
+	});
+	return;
+}
+
+void Image_EGA_Planar::flipV()
+{
+	auto dims = this->dimensions();
+
+	unsigned int numPlanes = 0;
+	for (auto p : this->planes) {
+		if (p != EGAPlanePurpose::Unused) numPlanes++;
+	}
+	unsigned int lenRow = (dims.x + 7) / 8;
+	unsigned long lenPlane = lenRow * dims.y;
+
+	this->rewriteData(numPlanes * lenPlane, [=](uint8_t *data) {
+		// Each plane is flipped separately
+		for (unsigned int p = 0; p < numPlanes; p++) {
+			Image_EGA::reverseRows(data + p * lenPlane, dims.y, lenRow);
+		}
+	});
+	return;
+}
+
+void Image_EGA_Planar::doConversion(uint8_t *pixels, uint8_t *mask,
+	size_t stride)
 {
 	this->content->seekg(this->offset, stream::start);
 
 	auto dims = this->dimensions();
-	this->pixels = Pixels(dims.x * dims.y, '\x00');
-	this->mask = Pixels(dims.x * dims.y, '\x00');
 
-	unsigned int planeSizeBytes = dims.y * ((dims.x + 7) / 8);
+	unsigned int lenRow = (dims.x + 7) / 8;
+	unsigned int planeSizeBytes = dims.y * lenRow;
+	ArenaPixels row(lenRow);
 	stream::len lenSkip = 0;
 	for (auto p : this->planes) {
 		if (p == EGAPlanePurpose::Unused) continue;
-		if (p == EGAPlanePurpose::Blank) {
-			// Don't waste time processing a plane we're ignoring
+
+		bool doMask, swap;
+		uint8_t value;
+		Image_EGA::planeInfo(p, doMask, value, swap);
+
+		auto target = doMask ? mask : pixels;
+		if ((p == EGAPlanePurpose::Blank) || (!target)) {
+			// Don't waste time processing a plane we're ignoring, or one the caller
+			// doesn't want.
 			lenSkip += planeSizeBytes;
 			// Don't do the skip here in case the unused planes are all at the end
 			// and we will end up seeking past EOF
@@ -127,51 +463,18 @@ void Image_EGA_Planar::doConversion()
 			// We're processing this plane and it's following one or more ignored
 			// planes, so now do the seek.
 			this->content->seekg(lenSkip, stream::cur);
+			lenSkip = 0;
 		}
 
-		bool doMask = false, swap = false;
-		uint8_t value = 0;
-		switch (p) {
-			case EGAPlanePurpose::Unused: continue;
-			case EGAPlanePurpose::Blank:  continue;
-			case EGAPlanePurpose::Blue0:      doMask = false; value = 0x01; swap = true;  break;
-			case EGAPlanePurpose::Blue1:      doMask = false; value = 0x01; swap = false; break;
-			case EGAPlanePurpose::Green0:     doMask = false; value = 0x02; swap = true;  break;
-			case EGAPlanePurpose::Green1:     doMask = false; value = 0x02; swap = false; break;
-			case EGAPlanePurpose::Red0:       doMask = false; value = 0x04; swap = true;  break;
-			case EGAPlanePurpose::Red1:       doMask = false; value = 0x04; swap = false; break;
-			case EGAPlanePurpose::Intensity0: doMask = false; value = 0x08; swap = true;  break;
-			case EGAPlanePurpose::Intensity1: doMask = false; value = 0x08; swap = false; break;
-			case EGAPlanePurpose::Hit0:       doMask = true;  value = (uint8_t)Mask::Touch;       swap = true;  break;
-			case EGAPlanePurpose::Hit1:       doMask = true;  value = (uint8_t)Mask::Touch;       swap = false; break;
-			case EGAPlanePurpose::Opaque0:    doMask = true;  value = (uint8_t)Mask::Transparent; swap = false;  break;
-			case EGAPlanePurpose::Opaque1:    doMask = true;  value = (uint8_t)Mask::Transparent; swap = true; break;
-		}
-
-		auto rowData = doMask ? &this->mask[0] : &this->pixels[0];
 		for (unsigned int y = 0; y < dims.y; y++) {
-			// Run through each lot of eight pixels (a "cell"), including a partial
-			// cell at the end if the width isn't a multiple of 8.
-			for (unsigned int x = 0; x < dims.x; x += 8) {
-
-				uint8_t nextByte;
-				try {
-					*this->content >> u8(nextByte);
-				} catch (const stream::incomplete_read&) {
-					std::cerr << "ERROR: Incomplete read converting image to standard "
-						"format.  Returning partial conversion." << std::endl;
-					return;
-				}
-
-				// See which bit we should read down to (starting at 7.)  This is only
-				// used when the image is not an even multiple of 8.
-				int bits = 0;
-				if (x + 8 > dims.x) bits = 8 - (dims.x % 8);
-
-				// Run through all the (valid) bits in this byte
-				for (int b = 7; b >= bits; b--) {
-					*rowData++ |= (((nextByte >> b) & 1) ^ swap) ? value : 0x00;
-				}
+			auto lenRead = this->content->try_read(row.data(), lenRow);
+			// Decode as much of the row as we got, even if it was cut short
+			this->decodePlaneRow(target + y * stride, row.data(),
+				std::min<long>(dims.x, lenRead * 8), value, swap);
+			if (lenRead < lenRow) {
+				std::cerr << "ERROR: Incomplete read converting image to standard "
+					"format.  Returning partial conversion." << std::endl;
+				return;
 			}
 		}
 	}
@@ -47,11 +47,20 @@ class CAMOTO_GAMEGRAPHICS_API Image_EGA_Planar: public Image_EGA
 		virtual ~Image_EGA_Planar();
 
 		using Image_EGA::convert;
+		virtual Pixels convert(const Rect& region) const;
+		virtual Pixels convertPreview(unsigned int shift) const;
+		virtual Pixels convertPacked() const;
+		virtual void convertMaskPacked(Pixels& transparent, Pixels& touch) const;
 		virtual void convert(const Pixels& newContent, const Pixels& newMask);
+		virtual void convert(const Rect& region, const Pixels& newContent,
+			const Pixels& newMask);
+		virtual void flipH();
+		virtual void flipV();
+		virtual bool isUniform(uint8_t *colour, uint8_t *mask = nullptr) const;
 
 	protected:
-		/// Populate this->pixels and this->mask
-		virtual void doConversion();
+		virtual void doConversion(uint8_t *pixels, uint8_t *mask, size_t stride);
+		virtual stream::len lenData() const;
 };
 
 /// Filetype handler for full screen raw EGA images.
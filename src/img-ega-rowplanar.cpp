@@ -18,6 +18,7 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
 #include <iostream>
 #include <cstring>  // memset
 #include <cassert>
@@ -41,6 +42,7 @@ Image_EGA_RowPlanar::~Image_EGA_RowPlanar()
 void Image_EGA_RowPlanar::convert(const Pixels& newContent,
 	const Pixels& newMask)
 {
+	this->cache.invalidate();
 	this->content->seekp(this->offset, stream::start);
 	auto dims = this->dimensions();
 
@@ -56,24 +58,9 @@ void Image_EGA_RowPlanar::convert(const Pixels& newContent,
 			// Run through each lot of eight pixels (a "cell")
 			for (unsigned int x = 0; x < dims.x; x += 8) {
 
-				bool doMask = false, swap = false;
-				uint8_t value = 0;
-				switch (p) {
-					case EGAPlanePurpose::Unused: continue;
-					case EGAPlanePurpose::Blank:      doMask = false; value = 0x00; swap = false; break;
-					case EGAPlanePurpose::Blue0:      doMask = false; value = 0x01; swap = true;  break;
-					case EGAPlanePurpose::Blue1:      doMask = false; value = 0x01; swap = false; break;
-					case EGAPlanePurpose::Green0:     doMask = false; value = 0x02; swap = true;  break;
-					case EGAPlanePurpose::Green1:     doMask = false; value = 0x02; swap = false; break;
-					case EGAPlanePurpose::Red0:       doMask = false; value = 0x04; swap = true;  break;
-					case EGAPlanePurpose::Red1:       doMask = false; value = 0x04; swap = false; break;
-					case EGAPlanePurpose::Intensity0: doMask = false; value = 0x08; swap = true;  break;
-					case EGAPlanePurpose::Intensity1: doMask = false; value = 0x08; swap = false; break;
-					case EGAPlanePurpose::Hit0:       doMask = true;  value = (uint8_t)Mask::Touch;       swap = true;  break;
-					case EGAPlanePurpose::Hit1:       doMask = true;  value = (uint8_t)Mask::Touch;       swap = false; break;
-					case EGAPlanePurpose::Opaque0:    doMask = true;  value = (uint8_t)Mask::Transparent; swap = false;  break;
-					case EGAPlanePurpose::Opaque1:    doMask = true;  value = (uint8_t)Mask::Transparent; swap = true; break;
-				}
+				bool doMask, swap;
+				uint8_t value;
+				Image_EGA::planeInfo(p, doMask, value, swap);
 
 				// Work out if this plane will read from the input image or mask data.
 				auto rowData = doMask ? maskData : imgData;
@@ -105,65 +92,116 @@ void Image_EGA_RowPlanar::convert(const Pixels& newContent,
 	return;
 }
 
-void Image_EGA_RowPlanar::doConversion()
+void Image_EGA_RowPlanar::flipH()
+{
+	auto dims = this->dimensions();
+	if (dims.x % 8) {
+		// Partial bytes at the end of each row can't be mirrored in place
+		this->Image::flipH();
+		return;
+	}
+
+	unsigned int numPlanes = 0;
+	for (auto p : this->planes) {
+		if (p == EGAPlanePurpose::Unused) break;
+		numPlanes++;
+	}
+	unsigned int lenRow = dims.x / 8;
+
+	this->rewriteData(numPlanes * lenRow * dims.y, [=](uint8_t *data) {
+		// Each plane within each row is mirrored separately
+		Image_EGA::mirrorRows(data, numPlanes * dims.y, lenRow);
+	});
+	return;
+}
+
+void Image_EGA_RowPlanar::flipV()
+{
+	auto dims = this->dimensions();
+
+	unsigned int numPlanes = 0;
+	for (auto p : this->planes) {
+		if (p == EGAPlanePurpose::Unused) break;
+		numPlanes++;
+	}
+	// All the planes for one row are kept together, so they move as one
+	unsigned int lenRow = numPlanes * ((dims.x + 7) / 8);
+
+	this->rewriteData(lenRow * dims.y, [=](uint8_t *data) {
+		Image_EGA::reverseRows(data, dims.y, lenRow);
+	});
+	return;
+}
+
+bool Image_EGA_RowPlanar::isUniform(uint8_t *colour, uint8_t *mask) const
+{
+	auto dims = this->dimensions();
+	unsigned int numPlanes = 0;
+	for (auto p : this->planes) {
+		if (p == EGAPlanePurpose::Unused) break;
+		numPlanes++;
+	}
+
+	// Partial cells have padding bits, and blank planes can hold anything, so
+	// in both cases the bytes can't be compared as a whole.
+	if (
+		this->cache.valid() || (dims.x % 8) || (dims.x == 0) || (dims.y == 0)
+		|| (numPlanes == 0) || this->hasBlankPlanes(numPlanes)
+	) {
+		return this->Image_EGA::isUniform(colour, mask);
+	}
+
+	unsigned int lenRow = dims.x / 8;
+	unsigned int lenAllPlanes = lenRow * numPlanes;
+	stream::len len = this->lenData();
+	ArenaPixels data(len);
+	this->content->seekg(this->offset, stream::start);
+	this->content->read(data.data(), len);
+
+	// Each row is a full row from each plane in turn, so the image is uniform
+	// if every row matches the one before it and the planes are solid.
+	if (memcmp(data.data(), data.data() + lenAllPlanes, len - lenAllPlanes)) {
+		return false;
+	}
+	std::vector<uint8_t> planeBytes;
+	for (unsigned int p = 0; p < numPlanes; p++) {
+		if (!Image::allSame(&data[p * lenRow], lenRow)) return false;
+		planeBytes.push_back(data[p * lenRow]);
+	}
+	return this->uniformPixel(planeBytes, colour, mask);
+}
+
+void Image_EGA_RowPlanar::doConversion(uint8_t *pixels, uint8_t *mask,
+	size_t stride)
 {
 	this->content->seekg(this->offset, stream::start);
 
 	auto dims = this->dimensions();
-	this->pixels = Pixels(dims.x * dims.y, '\x00');
-	this->mask = Pixels(dims.x * dims.y, '\x00');
+	unsigned int lenRow = (dims.x + 7) / 8;
+	ArenaPixels row(lenRow);
 
 	for (unsigned int y = 0; y < dims.y; y++) {
 
 		for (auto p : this->planes) {
 			if (p == EGAPlanePurpose::Unused) break;
 
-			auto imgData = &this->pixels[y * dims.x];
-			auto maskData = &this->mask[y * dims.x];
+			bool doMask, swap;
+			uint8_t value;
+			Image_EGA::planeInfo(p, doMask, value, swap);
 
-			// Run through each lot of eight pixels (a "cell"), including a partial
-			// cell at the end if the width isn't a multiple of 8.
-			for (unsigned int x = 0; x < dims.x; x += 8) {
-				bool doMask = false, swap = false;
-				uint8_t value = 0;
-				switch (p) {
-					case EGAPlanePurpose::Unused: continue;
-					case EGAPlanePurpose::Blank:      doMask = false; value = 0x00; swap = false; break;
-					case EGAPlanePurpose::Blue0:      doMask = false; value = 0x01; swap = true;  break;
-					case EGAPlanePurpose::Blue1:      doMask = false; value = 0x01; swap = false; break;
-					case EGAPlanePurpose::Green0:     doMask = false; value = 0x02; swap = true;  break;
-					case EGAPlanePurpose::Green1:     doMask = false; value = 0x02; swap = false; break;
-					case EGAPlanePurpose::Red0:       doMask = false; value = 0x04; swap = true;  break;
-					case EGAPlanePurpose::Red1:       doMask = false; value = 0x04; swap = false; break;
-					case EGAPlanePurpose::Intensity0: doMask = false; value = 0x08; swap = true;  break;
-					case EGAPlanePurpose::Intensity1: doMask = false; value = 0x08; swap = false; break;
-					case EGAPlanePurpose::Hit0:       doMask = true;  value = (uint8_t)Mask::Touch;       swap = true;  break;
-					case EGAPlanePurpose::Hit1:       doMask = true;  value = (uint8_t)Mask::Touch;       swap = false; break;
-					case EGAPlanePurpose::Opaque0:    doMask = true;  value = (uint8_t)Mask::Transparent; swap = false;  break;
-					case EGAPlanePurpose::Opaque1:    doMask = true;  value = (uint8_t)Mask::Transparent; swap = true; break;
-				}
-
-				uint8_t nextByte;
-				try {
-					*this->content >> u8(nextByte);
-				} catch (const stream::incomplete_read&) {
-					std::cerr << "ERROR: Incomplete read converting image to standard "
-						"format.  Returning partial conversion." << std::endl;
-					return;
-				}
-
-				// See which bit we should read down to (starting at 7.)  This is only
-				// used when the image is not an even multiple of 8.
-				int bits = 0;
-				if (x + 8 > dims.x) bits = 8 - (dims.x % 8);
+			// Each plane's row is stored in one piece, so read it all at once
+			auto lenRead = this->content->try_read(row.data(), lenRow);
 
-				// Run through all the (valid) bits in this byte
-				auto rowData = doMask ? maskData : imgData;
-				for (int b = 7; b >= bits; b--) {
-					*rowData++ |= (((nextByte >> b) & 1) ^ swap) ? value : 0x00;
-				}
-				imgData += 8;
-				maskData += 8;
+			auto target = doMask ? mask : pixels;
+			if (target) { // skip if the caller doesn't want this plane
+				// Decode as much of the row as we got, even if it was cut short
+				this->decodePlaneRow(target + y * stride, row.data(),
+					std::min<long>(dims.x, lenRead * 8), value, swap);
+			}
+			if (lenRead < lenRow) {
+				std::cerr << "ERROR: Incomplete read converting image to standard "
+					"format.  Returning partial conversion." << std::endl;
+				return;
 			}
 		}
 	}
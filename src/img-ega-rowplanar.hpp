@@ -45,10 +45,12 @@ class CAMOTO_GAMEGRAPHICS_API Image_EGA_RowPlanar: public Image_EGA
 
 		using Image_EGA::convert;
 		virtual void convert(const Pixels& newContent, const Pixels& newMask);
+		virtual void flipH();
+		virtual void flipV();
+		virtual bool isUniform(uint8_t *colour, uint8_t *mask = nullptr) const;
 
 	protected:
-		/// Populate this->pixels and this->mask
-		virtual void doConversion();
+		virtual void doConversion(uint8_t *pixels, uint8_t *mask, size_t stride);
 };
 
 } // namespace gamegraphics
@@ -18,12 +18,45 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
 #include <cassert>
+#include <cstring>
+#include "content-hash.hpp"
 #include "img-ega.hpp"
 
 namespace camoto {
 namespace gamegraphics {
 
+/// Each byte value with the order of its bits reversed
+static const std::array<uint8_t, 256> bitReverse = []() {
+	std::array<uint8_t, 256> table;
+	for (unsigned int i = 0; i < 256; i++) {
+		uint8_t r = 0;
+		for (unsigned int b = 0; b < 8; b++) {
+			if (i & (1 << b)) r |= 0x80 >> b;
+		}
+		table[i] = r;
+	}
+	return table;
+}();
+
+/// Each byte value expanded to one byte per bit, leftmost pixel first.
+/**
+ * Each of the eight bytes is 0x00 or 0x01, so multiplying an entry by a
+ * pixel value gives eight decoded pixels that can be ORed into place at once.
+ * The bytes are arranged in memory order, so this works the same on any
+ * endianness.
+ */
+static const std::array<uint64_t, 256> planeCells = []() {
+	std::array<uint64_t, 256> table;
+	for (unsigned int i = 0; i < 256; i++) {
+		uint8_t cell[8];
+		for (unsigned int b = 0; b < 8; b++) cell[b] = (i >> (7 - b)) & 1;
+		memcpy(&table[i], cell, sizeof(cell));
+	}
+	return table;
+}();
+
 Image_EGA::Image_EGA(std::unique_ptr<stream::inout> content, stream::pos offset,
 	Point dimensions, EGAPlaneLayout planes, std::shared_ptr<const Palette> pal)
 	:	content(std::move(content)),
@@ -48,6 +81,26 @@ ColourDepth Image_EGA::colourDepth() const
 	return ColourDepth::EGA;
 }
 
+Image::MaskKind Image_EGA::maskKind() const
+{
+	auto kind = MaskKind::Opaque;
+	for (auto& p : this->planes) {
+		switch (p) {
+			case EGAPlanePurpose::Opaque0:
+			case EGAPlanePurpose::Opaque1:
+				kind = kind | MaskKind::Transparent;
+				break;
+			case EGAPlanePurpose::Hit0:
+			case EGAPlanePurpose::Hit1:
+				kind = kind | MaskKind::Touch;
+				break;
+			default:
+				break;
+		}
+	}
+	return kind;
+}
+
 Point Image_EGA::dimensions() const
 {
 	return this->dims;
@@ -67,50 +120,317 @@ void Image_EGA::dimensions(const Point& newDimensions)
 	this->content->truncate(this->offset +
 		(newDimensions.x * numPlanes + 7) / 8 * newDimensions.y);
 	this->dims = newDimensions;
+	this->cache.invalidate();
 	return;
 }
 
+stream::len Image_EGA::encodedSize(const Pixels& newContent,
+	const Pixels& newMask) const
+{
+	return this->offset + this->lenData();
+}
+
+uint64_t Image_EGA::contentHash() const
+{
+	// The layout is fixed, so the stored bytes identify the image
+	ContentHash hash(ContentHash::Domain::Encoded, this->dimensions());
+	hash.add(*this->content, this->offset, this->lenData());
+	return hash.value();
+}
+
 Pixels Image_EGA::convert() const
 {
-	if (this->pixels.size() == 0) {
-		// Populate cache
-		auto noconst_this = const_cast<Image_EGA*>(this);
-		noconst_this->doConversion();
+	if (!this->cache.valid()) {
+		Pixels pixels, mask;
+		this->decode(pixels, mask);
+		if (!this->cache.enabled()) return pixels;
+		this->cache.store(std::move(pixels), std::move(mask));
 	}
-	return this->pixels;
+	return *this->cache.pixels;
 }
 
 Pixels Image_EGA::convert_mask() const
 {
-	if (this->mask.size() == 0) {
-		bool hasMask = false;
-		for (auto& p : this->planes) {
-			if (
-				(p == EGAPlanePurpose::Opaque0) ||
-				(p == EGAPlanePurpose::Opaque1) ||
-				(p == EGAPlanePurpose::Hit0) ||
-				(p == EGAPlanePurpose::Hit1)
-			) {
-				hasMask = true;
-				break;
-			}
-		}
-		// Populate cache
-		auto noconst_this = const_cast<Image_EGA*>(this);
-		if (!hasMask) {
+	if (!this->cache.valid()) {
+		if (!this->hasMaskPlanes()) {
 			// Mask is unused, skip the conversion and return an opaque mask
 			auto dims = this->dimensions();
 			assert((dims.x != 0) && (dims.y != 0));
 			int dataSize = dims.x * dims.y;
 
 			// Return an entirely opaque mask
-			noconst_this->mask = Pixels(dataSize, 0x00);
-		} else {
-			noconst_this->doConversion();
+			return Pixels(dataSize, 0x00);
 		}
+		Pixels pixels, mask;
+		this->decode(pixels, mask);
+		if (!this->cache.enabled()) return mask;
+		this->cache.store(std::move(pixels), std::move(mask));
 	}
+	return *this->cache.mask;
+}
+
+void Image_EGA::convertBoth(Pixels& pixels, Pixels& mask) const
+{
+	if (!this->cache.valid()) {
+		// The planes are all decoded in the same pass, so this gives us the mask
+		// as well.
+		if (!this->cache.enabled()) {
+			// Nothing to keep, so decode straight into the caller's buffers
+			this->decode(pixels, mask);
+			return;
+		}
+		Pixels newPixels, newMask;
+		this->decode(newPixels, newMask);
+		this->cache.store(std::move(newPixels), std::move(newMask));
+	}
+	pixels = *this->cache.pixels;
+	mask = *this->cache.mask;
+	return;
+}
+
+SharedPixels Image_EGA::convertShared() const
+{
+	if (!this->cache.valid()) {
+		Pixels pixels, mask;
+		this->decode(pixels, mask);
+		if (!this->cache.enabled()) return SharedPixels(std::move(pixels));
+		this->cache.store(std::move(pixels), std::move(mask));
+	}
+	// Hand out the cached buffer itself rather than a copy
+	return this->cache.pixels;
+}
+
+void Image_EGA::convertBothShared(SharedPixels& pixels, SharedPixels& mask)
+	const
+{
+	if (!this->cache.valid()) {
+		Pixels newPixels, newMask;
+		this->decode(newPixels, newMask);
+		if (!this->cache.enabled()) {
+			pixels = SharedPixels(std::move(newPixels));
+			mask = SharedPixels(std::move(newMask));
+			return;
+		}
+		this->cache.store(std::move(newPixels), std::move(newMask));
+	}
+	pixels = this->cache.pixels;
+	mask = this->cache.mask;
+	return;
+}
+
+void Image_EGA::convertMaskPacked(Pixels& transparent, Pixels& touch) const
+{
+	if (!this->hasMaskPlanes()) {
+		// Mask is unused, so it's entirely opaque and never hit
+		auto dims = this->dimensions();
+		size_t lenPlane = (dims.x + 7) / 8 * dims.y;
+		transparent.assign(lenPlane, 0x00);
+		touch.assign(lenPlane, 0x00);
+		return;
+	}
+	this->Image::convertMaskPacked(transparent, touch);
+	return;
+}
+
+void Image_EGA::convertInto(uint8_t *pixels, uint8_t *mask, size_t stride)
+	const
+{
+	auto dims = this->dimensions();
+	assert(stride >= (size_t)dims.x);
+
+	// Use the cache if a previous call to convert() has already decoded the
+	// image, otherwise decode straight into the caller's buffers.
+	if (this->cache.valid()) {
+		if (pixels) this->copyRows(pixels, stride, dims, this->cache.pixels.data());
+		if (mask) this->copyRows(mask, stride, dims, this->cache.mask.data());
+		return;
+	}
+
+	if (mask) {
+		this->fillRows(mask, stride, dims, 0x00);
+		// Don't bother reading the image if only an empty mask was wanted
+		if (!pixels && !this->hasMaskPlanes()) return;
+	}
+	if (pixels) this->fillRows(pixels, stride, dims, 0x00);
+
+	auto noconst_this = const_cast<Image_EGA*>(this);
+	noconst_this->doConversion(pixels, mask, stride);
+	return;
+}
+
+void Image_EGA::dropCache()
+{
+	this->cache.release();
+	return;
+}
 
-	return this->mask;
+void Image_EGA::cacheDecoded(bool keep)
+{
+	this->cache.enabled(keep);
+	return;
+}
+
+void Image_EGA::decode(Pixels& pixels, Pixels& mask) const
+{
+	auto dims = this->dimensions();
+	pixels.assign(dims.x * dims.y, '\x00');
+	mask.assign(dims.x * dims.y, '\x00');
+	auto noconst_this = const_cast<Image_EGA*>(this);
+	noconst_this->doConversion(pixels.data(), mask.data(), dims.x);
+	return;
+}
+
+bool Image_EGA::hasMaskPlanes() const
+{
+	for (auto& p : this->planes) {
+		if (
+			(p == EGAPlanePurpose::Opaque0) ||
+			(p == EGAPlanePurpose::Opaque1) ||
+			(p == EGAPlanePurpose::Hit0) ||
+			(p == EGAPlanePurpose::Hit1)
+		) {
+			return true;
+		}
+	}
+	return false;
+}
+
+bool Image_EGA::hasBlankPlanes(unsigned int numPlanes) const
+{
+	for (auto& p : this->planes) {
+		if (p == EGAPlanePurpose::Unused) continue;
+		if (numPlanes-- == 0) break;
+		if (p == EGAPlanePurpose::Blank) return true;
+	}
+	return false;
+}
+
+bool Image_EGA::uniformPixel(const std::vector<uint8_t>& planeBytes,
+	uint8_t *colour, uint8_t *mask) const
+{
+	uint8_t pixel = 0x00, pixelMask = 0x00;
+	unsigned int i = 0;
+	for (auto p : this->planes) {
+		if (p == EGAPlanePurpose::Unused) continue;
+		if (i >= planeBytes.size()) break;
+		auto b = planeBytes[i++];
+		if (p == EGAPlanePurpose::Blank) continue;
+
+		bool doMask, swap;
+		uint8_t value;
+		Image_EGA::planeInfo(p, doMask, value, swap);
+
+		// Every pixel must have the same bit in this plane
+		if ((b != 0x00) && (b != 0xFF)) return false;
+		bool on = b != 0x00;
+		if (on ^ swap) {
+			if (doMask) pixelMask |= value;
+			else pixel |= value;
+		}
+	}
+	if (colour) *colour = pixel;
+	if (mask) *mask = pixelMask;
+	return true;
+}
+
+stream::len Image_EGA::lenData() const
+{
+	auto dims = this->dimensions();
+
+	// Each plane is written out until the first unused one
+	unsigned int numPlanes = 0;
+	for (auto p : this->planes) {
+		if (p == EGAPlanePurpose::Unused) break;
+		numPlanes++;
+	}
+
+	// Each plane of each row is padded out to a whole byte
+	return numPlanes * ((dims.x + 7) / 8) * dims.y;
+}
+
+void Image_EGA::rewriteData(stream::len lenData,
+	const std::function<void(uint8_t *data)>& fnChange)
+{
+	ArenaPixels data(lenData);
+	this->content->seekg(this->offset, stream::start);
+	this->content->read(data.data(), lenData);
+
+	fnChange(data.data());
+
+	this->cache.invalidate();
+	this->content->seekp(this->offset, stream::start);
+	this->content->write(data.data(), lenData);
+	this->content->flush();
+	return;
+}
+
+void Image_EGA::planeInfo(EGAPlanePurpose p, bool& doMask, uint8_t& value,
+	bool& swap)
+{
+	switch (p) {
+		case EGAPlanePurpose::Unused:     doMask = false; value = 0x00; swap = false; break;
+		case EGAPlanePurpose::Blank:      doMask = false; value = 0x00; swap = false; break;
+		case EGAPlanePurpose::Blue0:      doMask = false; value = 0x01; swap = true;  break;
+		case EGAPlanePurpose::Blue1:      doMask = false; value = 0x01; swap = false; break;
+		case EGAPlanePurpose::Green0:     doMask = false; value = 0x02; swap = true;  break;
+		case EGAPlanePurpose::Green1:     doMask = false; value = 0x02; swap = false; break;
+		case EGAPlanePurpose::Red0:       doMask = false; value = 0x04; swap = true;  break;
+		case EGAPlanePurpose::Red1:       doMask = false; value = 0x04; swap = false; break;
+		case EGAPlanePurpose::Intensity0: doMask = false; value = 0x08; swap = true;  break;
+		case EGAPlanePurpose::Intensity1: doMask = false; value = 0x08; swap = false; break;
+		case EGAPlanePurpose::Hit0:       doMask = true;  value = (uint8_t)Mask::Touch;       swap = true;  break;
+		case EGAPlanePurpose::Hit1:       doMask = true;  value = (uint8_t)Mask::Touch;       swap = false; break;
+		case EGAPlanePurpose::Opaque0:    doMask = true;  value = (uint8_t)Mask::Transparent; swap = false; break;
+		case EGAPlanePurpose::Opaque1:    doMask = true;  value = (uint8_t)Mask::Transparent; swap = true;  break;
+	}
+	return;
+}
+
+void Image_EGA::decodePlaneRow(uint8_t *dst, const uint8_t *src, long width,
+	uint8_t value, bool swap)
+{
+	uint8_t invert = swap ? 0xFF : 0x00;
+	uint64_t cell;
+	// Whole cells of eight pixels
+	for (; width >= 8; width -= 8) {
+		uint64_t bits = planeCells[*src++ ^ invert] * value;
+		memcpy(&cell, dst, sizeof(cell));
+		cell |= bits;
+		memcpy(dst, &cell, sizeof(cell));
+		dst += 8;
+	}
+	// Partial cell at the end of the row
+	if (width > 0) {
+		uint8_t partial[8];
+		cell = planeCells[*src ^ invert] * value;
+		memcpy(partial, &cell, sizeof(cell));
+		for (long x = 0; x < width; x++) dst[x] |= partial[x];
+	}
+	return;
+}
+
+void Image_EGA::mirrorRows(uint8_t *data, unsigned long numRows,
+	unsigned int lenRow)
+{
+	for (unsigned long y = 0; y < numRows; y++) {
+		// Swap the bytes end for end, then swap the pixels within each byte
+		std::reverse(data, data + lenRow);
+		for (unsigned int x = 0; x < lenRow; x++) {
+			data[x] = bitReverse[data[x]];
+		}
+		data += lenRow;
+	}
+	return;
+}
+
+void Image_EGA::reverseRows(uint8_t *data, unsigned long numRows,
+	unsigned int lenRow)
+{
+	for (unsigned long y = 0; y < numRows / 2; y++) {
+		std::swap_ranges(data + y * lenRow, data + (y + 1) * lenRow,
+			data + (numRows - 1 - y) * lenRow);
+	}
+	return;
 }
 
 } // namespace gamegraphics
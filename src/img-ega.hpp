@@ -22,8 +22,11 @@
 #define _CAMOTO_IMG_EGA_HPP_
 
 #include <array>
+#include <functional>
+#include <vector>
 #include <camoto/config.hpp>
 #include <camoto/gamegraphics/image.hpp>
+#include "image-cache.hpp"
 
 namespace camoto {
 namespace gamegraphics {
@@ -73,6 +76,8 @@ enum class PlaneCount
  * Up to six image planes are supported - the usual RGBI planes, as well as
  * transparency and hitmapping.
  *
+ * contentHash() hashes the stored plane data (the encoded domain), so hashes
+ * only match other images with the same plane layout.
  */
 class CAMOTO_GAMEGRAPHICS_API Image_EGA: public Image
 {
@@ -84,23 +89,186 @@ class CAMOTO_GAMEGRAPHICS_API Image_EGA: public Image
 
 		virtual Caps caps() const;
 		virtual ColourDepth colourDepth() const;
+		virtual MaskKind maskKind() const;
 		virtual Point dimensions() const;
 		virtual void dimensions(const Point& newDimensions);
 		using Image::convert;
 		virtual Pixels convert() const;
 		virtual Pixels convert_mask() const;
+		virtual void convertBoth(Pixels& pixels, Pixels& mask) const;
+		virtual SharedPixels convertShared() const;
+		virtual void convertBothShared(SharedPixels& pixels, SharedPixels& mask)
+			const;
+		virtual void convertMaskPacked(Pixels& transparent, Pixels& touch) const;
+		virtual void convertInto(uint8_t *pixels, uint8_t *mask, size_t stride)
+			const;
+		virtual stream::len encodedSize(const Pixels& newContent,
+			const Pixels& newMask) const;
+		virtual uint64_t contentHash() const;
+		virtual void dropCache();
+		virtual void cacheDecoded(bool keep);
 
 	protected:
-		/// Populate this->pixels and this->mask
-		virtual void doConversion() = 0;
+		/// Does the plane layout include any mask or hitmap planes?
+		bool hasMaskPlanes() const;
+
+		/// Does the plane layout include any blank planes?
+		/**
+		 * @param numPlanes
+		 *   Number of planes to check, not counting unused ones.
+		 */
+		bool hasBlankPlanes(unsigned int numPlanes) const;
+
+		/// Work out the pixel in an image where each plane is a single value.
+		/**
+		 * Helper function for isUniform() implementations, once they have found
+		 * every byte in each plane to be the same.
+		 *
+		 * @param planeBytes
+		 *   Value of every byte in each plane, in the same order as \ref planes
+		 *   but skipping unused planes.  The value for blank planes is ignored.
+		 *
+		 * @param colour
+		 *   If not nullptr, set to the colour of every pixel.
+		 *
+		 * @param mask
+		 *   If not nullptr, set to the mask value of every pixel.
+		 *
+		 * @return false if any plane has both set and clear bits, in which case
+		 *   the pixels are not all the same.
+		 */
+		bool uniformPixel(const std::vector<uint8_t>& planeBytes, uint8_t *colour,
+			uint8_t *mask) const;
+
+		/// Decode the whole image into newly allocated buffers.
+		void decode(Pixels& pixels, Pixels& mask) const;
+
+		/// Number of bytes of image data following the offset.
+		/**
+		 * The default implementation is correct for layouts that pad each plane
+		 * of each row out to a whole byte, and stop at the first unused plane.
+		 */
+		virtual stream::len lenData() const;
+
+		/// Modify the underlying image data in place.
+		/**
+		 * Reads the image data into memory, passes it to fnChange, then writes
+		 * it back out and discards any decoded copy of the image.
+		 *
+		 * @param lenData
+		 *   Number of bytes of image data, following the offset.
+		 *
+		 * @param fnChange
+		 *   Function to modify the data.
+		 */
+		void rewriteData(stream::len lenData,
+			const std::function<void(uint8_t *data)>& fnChange);
+
+		/// Mirror rows of plane data horizontally.
+		/**
+		 * Each row contains the bits for one plane only, with the leftmost pixel
+		 * in the most significant bit.  The rows must be a whole number of bytes
+		 * without any padding bits, otherwise the padding would end up at the
+		 * start of the row.
+		 *
+		 * @param data
+		 *   Plane data to change.
+		 *
+		 * @param numRows
+		 *   Number of rows in data.
+		 *
+		 * @param lenRow
+		 *   Length of each row, in bytes.
+		 */
+		static void mirrorRows(uint8_t *data, unsigned long numRows,
+			unsigned int lenRow);
+
+		/// Find out how a plane contributes to each decoded pixel.
+		/**
+		 * @param p
+		 *   Plane to look up.
+		 *
+		 * @param doMask
+		 *   Set to true if the plane belongs in the mask, false if it belongs in
+		 *   the pixel data.
+		 *
+		 * @param value
+		 *   Set to the bits each pixel gets when its bit in this plane is on.
+		 *   This is 0x00 for blank and unused planes.
+		 *
+		 * @param swap
+		 *   Set to true if the plane is stored inverted, so a pixel gets value
+		 *   when its bit is off.
+		 */
+		static void planeInfo(EGAPlanePurpose p, bool& doMask, uint8_t& value,
+			bool& swap);
+
+		/// Decode one row of a bit plane into 8bpp pixels.
+		/**
+		 * Each plane byte is expanded through a lookup table into eight pixels,
+		 * which are ORed into the destination together.
+		 *
+		 * @param dst
+		 *   Destination pixels, one byte per pixel.  Each pixel with its bit set
+		 *   has value ORed into it.
+		 *
+		 * @param src
+		 *   Plane data, with the leftmost pixel in the most significant bit.
+		 *   Must be (width + 7) / 8 bytes long.
+		 *
+		 * @param width
+		 *   Number of pixels to decode.
+		 *
+		 * @param value
+		 *   Value to OR into each pixel whose bit is set.
+		 *
+		 * @param swap
+		 *   true to treat each bit as inverted, so value is ORed into the pixels
+		 *   whose bit is clear.
+		 */
+		static void decodePlaneRow(uint8_t *dst, const uint8_t *src, long width,
+			uint8_t value, bool swap);
+
+		/// Reverse the order of rows of data.
+		/**
+		 * @param data
+		 *   Data to change.
+		 *
+		 * @param numRows
+		 *   Number of rows in data.
+		 *
+		 * @param lenRow
+		 *   Length of each row, in bytes.
+		 */
+		static void reverseRows(uint8_t *data, unsigned long numRows,
+			unsigned int lenRow);
+
+		/// Decode the image data into the given buffers.
+		/**
+		 * The buffers must already be filled with zeroes, as each plane is ORed
+		 * into the existing values.  Either buffer may be nullptr, in which case
+		 * the planes that would have been written there are skipped.
+		 *
+		 * @param pixels
+		 *   Destination for the image data, or nullptr.
+		 *
+		 * @param mask
+		 *   Destination for the mask data, or nullptr.
+		 *
+		 * @param stride
+		 *   Distance between the start of each row in the buffers, in bytes.
+		 */
+		virtual void doConversion(uint8_t *pixels, uint8_t *mask, size_t stride)
+			= 0;
 
 		std::shared_ptr<stream::inout> content;
 		stream::pos offset;
 		Point dims;
 		EGAPlaneLayout planes;
 
-		Pixels pixels;
-		Pixels mask;
+		/// Decoded copy of the image.  Subclasses must call cache.invalidate()
+		/// whenever they write to the underlying data.
+		mutable ImageCache cache;
 };
 
 } // namespace gamegraphics
@@ -48,6 +48,8 @@ class Image_Nukem2: public Image_EGA_Planar
 		virtual Caps caps() const;
 		virtual void convert(const Pixels& newContent,
 			const Pixels& newMask);
+		virtual stream::len encodedSize(const Pixels& newContent,
+			const Pixels& newMask) const;
 		virtual void palette(std::shared_ptr<const Palette> newPalette);
 		using Image_EGA::palette;
 };
@@ -205,6 +207,12 @@ void Image_Nukem2::convert(const Pixels& newContent,
 	return;
 }
 
+stream::len Image_Nukem2::encodedSize(const Pixels& newContent,
+	const Pixels& newMask) const
+{
+	return N2IMG_WIDTH * N2IMG_HEIGHT / 2 + N2IMG_PALSIZE;
+}
+
 void Image_Nukem2::palette(std::shared_ptr<const Palette> newPalette)
 {
 	if (newPalette && (newPalette->size() > 16)) {
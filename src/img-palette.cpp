@@ -58,5 +58,12 @@ void Image_Palette::convert(const Pixels& newContent,
 	return;
 }
 
+void Image_Palette::convertInto(uint8_t *pixels, uint8_t *mask,
+	size_t stride) const
+{
+	// Zero-sized image, nothing to write
+	return;
+}
+
 } // namespace gamegraphics
 } // namespace camoto
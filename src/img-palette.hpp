@@ -39,6 +39,8 @@ class Image_Palette: virtual public Image
 		virtual Pixels convert() const;
 		virtual Pixels convert_mask() const;
 		virtual void convert(const Pixels& newContent, const Pixels& newMask);
+		virtual void convertInto(uint8_t *pixels, uint8_t *mask, size_t stride)
+			const;
 };
 
 } // namespace gamearchive
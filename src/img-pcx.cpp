@@ -24,8 +24,10 @@
 #include <camoto/iostream_helpers.hpp>
 #include <camoto/util.hpp>
 #include <camoto/stream_filtered.hpp>
+#include <camoto/stream_string.hpp>
 #include <camoto/stream_sub.hpp>
 #include "img-pcx.hpp"
+#include "stream-count.hpp"
 
 /// Pad out to a multiple of two bytes
 /// @todo Does this work for files where it was four?
@@ -571,6 +573,11 @@ ColourDepth Image_PCX::colourDepth() const
 	return ColourDepth::Mono;
 }
 
+Image::MaskKind Image_PCX::maskKind() const
+{
+	return MaskKind::Opaque;
+}
+
 Point Image_PCX::dimensions() const
 {
 	return this->dims;
@@ -583,36 +590,57 @@ void Image_PCX::dimensions(const Point& newDimensions)
 	return;
 }
 
-Pixels Image_PCX::convert() const
+void Image_PCX::convertInto(uint8_t *pixels, uint8_t *mask, size_t stride)
+	const
 {
 	auto dims = this->dimensions();
 	assert((dims.x != 0) && (dims.y != 0));
+	assert(stride >= (size_t)dims.x);
 
-	Pixels imgData(dims.x * dims.y, '\x00');
+	// Return an entirely opaque mask
+	if (mask) this->fillRows(mask, stride, dims, 0x00);
+	if (pixels) this->decodeScanlines(pixels, stride, 0, dims.y);
+	return;
+}
 
-	this->content->seekg(66, stream::start);
-	int16_t bytesPerScanline;
-	*this->content
-		>> u16le(bytesPerScanline)
-	;
+Pixels Image_PCX::convert(const Rect& region) const
+{
+	this->checkRegion(region);
+	auto dims = this->dimensions();
+
+	// The scanlines have to be decoded in order, but we can stop once we have
+	// the last one we need.
+	Pixels rows(dims.x * region.height);
+	if (rows.empty()) return rows;
+	this->decodeScanlines(rows.data(), dims.x, region.y,
+		region.y + region.height);
+	if (region.width == dims.x) return rows;
+
+	Pixels pixels(region.width * region.height);
+	for (long y = 0; y < region.height; y++) {
+		memcpy(&pixels[y * region.width], &rows[y * dims.x + region.x],
+			region.width);
+	}
+	return pixels;
+}
+
+void Image_PCX::decodeRows(fn_image_row fnRow) const
+{
+	auto dims = this->dimensions();
+	this->decodeScanlines(nullptr, 0, 0, dims.y, fnRow);
+	return;
+}
+
+void Image_PCX::decodeScanlines(uint8_t *pixels, size_t stride,
+	unsigned int firstRow, unsigned int endRow, fn_image_row fnRow) const
+{
+	auto dims = this->dimensions();
+
+	int16_t bytesPerScanline = this->scanlineLength();
 //	if (bytesPerScanline % 2) throw stream::error("Invalid PCX file (bytes "
 //		"per scanline is not an even number)");
 
-	// Find the end of the pixel data
-	stream::len lenRLE = this->content->size() - 128; // 128 == header
-	if (this->ver >= 5) { // 3.0 or better, look for VGA pal
-		try {
-			uint8_t palSig = 0;
-			this->content->seekg(-769, stream::end);
-			*this->content >> u8(palSig);
-			if (palSig == 0x0C) {
-				// There is a VGA palette
-				lenRLE -= 769;
-			}
-		} catch (const stream::error&) {
-			// no palette
-		}
-	}
+	stream::len lenRLE = this->pixelDataLength();
 	std::shared_ptr<stream::input> content_pixels =
 		std::make_shared<stream::input_sub>(this->content, 128, lenRLE);
 
@@ -624,14 +652,22 @@ Pixels Image_PCX::convert() const
 		);
 	}
 
-	auto line = &imgData[0];
+	// Rows before firstRow are decoded into here and discarded
+	Pixels scratch(dims.x);
+
+	// PCX files have no transparency, so the mask is always opaque
+	Pixels rowMask;
+	if (fnRow) rowMask.resize(dims.x, 0x00);
+
 	/// @todo write bitstream version that takes input- and output-only streams (rather than r/w ones only)
 	auto bits = std::make_unique<bitstream>(bitstream::bigEndian);
 
 	fn_getnextchar cbNext = std::bind(&stream::input::try_read, content_pixels, std::placeholders::_1, 1);
 	unsigned int val;
 	bool eof = false;
-	for (unsigned int y = 0; y < dims.y; y++) {
+	for (unsigned int y = 0; y < endRow; y++) {
+		auto line = ((y < firstRow) || !pixels)
+			? scratch.data() : pixels + (y - firstRow) * stride;
 		memset(line, 0, dims.x); // blank out line
 		auto posScanlineStart = content_pixels->tellg();
 		for (unsigned int p = 0; p < this->numPlanes; p++) {
@@ -658,16 +694,9 @@ Pixels Image_PCX::convert() const
 		auto pad = bytesPerScanline - std::min<stream::pos>(bytesPerScanline, lenScanlineRead);
 		while (pad--) cbNext(&dummy);
 
-		line += dims.x;
+		if (fnRow && (y >= firstRow)) fnRow(y, line, rowMask.data());
 	}
-	return imgData;
-}
-
-Pixels Image_PCX::convert_mask() const
-{
-	// Return an entirely opaque mask
-	auto dims = this->dimensions();
-	return Pixels(dims.x * dims.y, '\x00');
+	return;
 }
 
 void Image_PCX::convert(const Pixels& newContent, const Pixels& newMask)
@@ -680,10 +709,7 @@ void Image_PCX::convert(const Pixels& newContent, const Pixels& newMask)
 	auto dims = this->dimensions();
 	assert((dims.x != 0) && (dims.y != 0));
 
-	const unsigned int bytesPerPlaneScanline = toNearestMultiple(dims.x * this->bitsPerPlane, 8) / 8;
-	unsigned int bytesPerScanline = bytesPerPlaneScanline * this->numPlanes;
-	// Pad out to a multiple of PLANE_PAD bytes
-	bytesPerScanline = toNearestMultiple(bytesPerScanline, PLANE_PAD);
+	unsigned int bytesPerScanline = this->encodedScanlineLength(dims);
 
 	// Assume worst case and enlarge file enough to fit complete data
 	stream::len maxSize = 128+bytesPerScanline * dims.y + 768+1;
@@ -747,15 +773,242 @@ void Image_PCX::convert(const Pixels& newContent, const Pixels& newMask)
 		);
 	}
 
-	auto line = &newContent[0];
+	this->encodeScanlines(content_pixels, newContent.data(), dims.y,
+		bytesPerScanline);
+	content_pixels->flush();
+	content_pixels.reset();
+
+	// Write the VGA palette if ver 5 and 256 colour pal
+	if ((this->ver >= 5) && (palSize > 16)) {
+		*this->content << u8(0x0C); // palette presence flag
+		for (int i = 0; i < std::min(palSize, 256); i++) {
+			*this->content
+				<< u8(pal->at(i).red)
+				<< u8(pal->at(i).green)
+				<< u8(pal->at(i).blue)
+			;
+		}
+		// Pad out to 256 colours if needed
+		for (int i = palSize; i < 256; i++) {
+			this->content->write("\0\0\0", 3);
+		}
+	}
+
+	this->content->truncate_here();
+
+	// The header and the length of the pixel data will have changed
+	this->hdrBytesPerScanline.set(bytesPerScanline);
+	this->lenPixelData.invalidate();
+	return;
+}
+
+void Image_PCX::convert(const Rect& region, const Pixels& newContent,
+	const Pixels& newMask)
+{
+	this->checkRegion(region);
+	if ((region.width == 0) || (region.height == 0)) return;
+
+	auto dims = this->dimensions();
+	unsigned int bytesPerScanline = this->encodedScanlineLength(dims);
+	bool rle = this->encoding == 1;
+
+	// The rows can only be replaced on their own if they will be encoded the
+	// same way as the rest of the file, otherwise the whole image is rewritten.
+	stream::pos offStart, offEnd;
+	if (
+		(this->content->size() < 128)
+		|| (rle && !this->useRLE)
+		|| (this->scanlineLength() != (int16_t)bytesPerScanline)
+		|| !this->findScanlines(region.y, region.y + region.height,
+			bytesPerScanline, &offStart, &offEnd)
+	) {
+		this->Image::convert(region, newContent, newMask);
+		return;
+	}
+	stream::len lenRLE = this->pixelDataLength();
+
+	// Decode the affected rows and copy the new pixels into them
+	Pixels rows(dims.x * region.height);
+	this->decodeScanlines(rows.data(), dims.x, region.y,
+		region.y + region.height);
+	for (long y = 0; y < region.height; y++) {
+		memcpy(&rows[y * dims.x + region.x], &newContent[y * region.width],
+			region.width);
+	}
+
+	// Each scanline is compressed on its own, so encoding just these rows gives
+	// the same data as they would have in a full encode of the image.
+	auto encoded = std::make_shared<stream::string>();
+	std::shared_ptr<stream::output> content_pixels = encoded;
+	if (rle) {
+		content_pixels = std::make_shared<stream::output_filtered>(
+			content_pixels,
+			std::make_shared<filter_pcx_rle>(bytesPerScanline),
+			nullptr
+		);
+	}
+	this->encodeScanlines(content_pixels, rows.data(), region.height,
+		bytesPerScanline);
+	content_pixels->flush();
+	content_pixels.reset();
+
+	// Make room for the new rows if they compressed to a different size, which
+	// moves the rest of the file (e.g. the VGA palette) along with them.
+	stream::len lenOld = offEnd - offStart;
+	stream::len lenNew = encoded->data.size();
+	this->content->seekp(128 + offStart, stream::start);
+	if (lenNew > lenOld) {
+		this->content->insert(lenNew - lenOld);
+	} else if (lenNew < lenOld) {
+		this->content->remove(lenOld - lenNew);
+	}
+	this->content->write(encoded->data);
+	this->content->flush();
+	this->lenPixelData.set(lenRLE - lenOld + lenNew);
+	return;
+}
+
+stream::len Image_PCX::encodedSize(const Pixels& newContent,
+	const Pixels& newMask) const
+{
+	auto dims = this->dimensions();
+	unsigned int bytesPerScanline = this->encodedScanlineLength(dims);
+
+	stream::len lenPixels;
+	if (this->useRLE && (this->encoding == 1)) {
+		// Run the data through the same encoder used by convert(), but send the
+		// compressed result to a stream that only counts the bytes.
+		auto counter = std::make_shared<stream_count>();
+		auto content_pixels = std::make_shared<stream::output_filtered>(
+			counter,
+			std::make_shared<filter_pcx_rle>(bytesPerScanline),
+			nullptr
+		);
+		this->encodeScanlines(content_pixels, newContent.data(), dims.y,
+			bytesPerScanline);
+		content_pixels->flush();
+		lenPixels = counter->size();
+	} else {
+		lenPixels = bytesPerScanline * dims.y;
+	}
+
+	// VGA palette, written by convert() for 256 colour images
+	stream::len lenPalette = 0;
+	if (this->ver >= 5) {
+		auto pal = this->palette();
+		if (pal && (pal->size() > 16)) lenPalette = 1 + 256 * 3;
+	}
+
+	return 128 + lenPixels + lenPalette;
+}
+
+void Image_PCX::dropCache()
+{
+	this->hdrBytesPerScanline.invalidate();
+	this->lenPixelData.invalidate();
+	return;
+}
+
+unsigned int Image_PCX::encodedScanlineLength(const Point& dims) const
+{
+	const unsigned int bytesPerPlaneScanline = toNearestMultiple(dims.x * this->bitsPerPlane, 8) / 8;
+	unsigned int bytesPerScanline = bytesPerPlaneScanline * this->numPlanes;
+	// Pad out to a multiple of PLANE_PAD bytes
+	return toNearestMultiple(bytesPerScanline, PLANE_PAD);
+}
+
+int16_t Image_PCX::scanlineLength() const
+{
+	return this->hdrBytesPerScanline.get([this]() {
+		int16_t bytesPerScanline;
+		this->content->seekg(66, stream::start);
+		*this->content
+			>> u16le(bytesPerScanline)
+		;
+		return bytesPerScanline;
+	});
+}
+
+stream::len Image_PCX::pixelDataLength() const
+{
+	// Find the end of the pixel data
+	return this->lenPixelData.get([this]() {
+		stream::len lenRLE = this->content->size() - 128; // 128 == header
+		if (this->ver >= 5) { // 3.0 or better, look for VGA pal
+			try {
+				uint8_t palSig = 0;
+				this->content->seekg(-769, stream::end);
+				*this->content >> u8(palSig);
+				if (palSig == 0x0C) {
+					// There is a VGA palette
+					lenRLE -= 769;
+				}
+			} catch (const stream::error&) {
+				// no palette
+			}
+		}
+		return lenRLE;
+	});
+}
+
+bool Image_PCX::findScanlines(unsigned int firstRow, unsigned int endRow,
+	unsigned int bytesPerScanline, stream::pos *offStart, stream::pos *offEnd)
+	const
+{
+	stream::len lenRLE = this->pixelDataLength();
+	stream::pos posStart = firstRow * bytesPerScanline;
+	stream::pos posEnd = endRow * bytesPerScanline;
+
+	if (this->encoding != 1) {
+		*offStart = posStart;
+		*offEnd = posEnd;
+		return posEnd <= lenRLE;
+	}
+
+	Pixels rle(lenRLE);
+	this->content->seekg(128, stream::start);
+	this->content->read(rle.data(), lenRLE);
+
+	// Run through the RLE codes until the decoded data reaches each row.  If a
+	// code runs across the start of either row, the rows can't be separated.
+	bool foundStart = false;
+	stream::pos posDecoded = 0;
+	stream::pos i = 0;
+	for (;;) {
+		if (posDecoded == posStart) {
+			*offStart = i;
+			foundStart = true;
+		}
+		if (posDecoded == posEnd) {
+			*offEnd = i;
+			return foundStart;
+		}
+		if ((posDecoded > posEnd) || (i >= lenRLE)) return false;
+		if ((rle[i] & 0xC0) == 0xC0) {
+			if (i + 1 >= lenRLE) return false;
+			posDecoded += rle[i] & 0x3F;
+			i += 2;
+		} else {
+			posDecoded++;
+			i++;
+		}
+	}
+}
+
+void Image_PCX::encodeScanlines(std::shared_ptr<stream::output> out,
+	const uint8_t *pixels, unsigned int numRows, unsigned int bytesPerScanline)
+	const
+{
+	auto dims = this->dimensions();
+	auto line = pixels;
 	auto bits = std::make_unique<bitstream>(bitstream::bigEndian);
 	uint8_t lastChar;
-	fn_putnextchar cbNext = std::bind(putNextChar, content_pixels, &lastChar, std::placeholders::_1);
+	fn_putnextchar cbNext = std::bind(putNextChar, out, &lastChar, std::placeholders::_1);
 	int planeMask = (1 << this->bitsPerPlane) - 1;
 	int val;
 
-	for (unsigned int y = 0; y < dims.y; y++) {
-		auto posScanlineStart = content_pixels->tellp();
+	for (unsigned int y = 0; y < numRows; y++) {
+		auto posScanlineStart = out->tellp();
 		for (unsigned int p = 0; p < this->numPlanes; p++) {
 			int bitsInPlane = (p * this->bitsPerPlane);
 			for (unsigned int x = 0; x < dims.x; x++) {
@@ -779,32 +1032,12 @@ void Image_PCX::convert(const Pixels& newContent, const Pixels& newMask)
 		}
 
 		// Pad scanline to bytesPerScanline bytes
-		auto lenScanlineWritten = content_pixels->tellp() - posScanlineStart;
+		auto lenScanlineWritten = out->tellp() - posScanlineStart;
 		auto pad = bytesPerScanline - std::min<stream::pos>(bytesPerScanline, lenScanlineWritten);
 		while (pad--) cbNext(lastChar);
 
 		line += dims.x;
 	}
-	content_pixels->flush();
-	content_pixels.reset();
-
-	// Write the VGA palette if ver 5 and 256 colour pal
-	if ((this->ver >= 5) && (palSize > 16)) {
-		*this->content << u8(0x0C); // palette presence flag
-		for (int i = 0; i < std::min(palSize, 256); i++) {
-			*this->content
-				<< u8(pal->at(i).red)
-				<< u8(pal->at(i).green)
-				<< u8(pal->at(i).blue)
-			;
-		}
-		// Pad out to 256 colours if needed
-		for (int i = palSize; i < 256; i++) {
-			this->content->write("\0\0\0", 3);
-		}
-	}
-
-	this->content->truncate_here();
 	return;
 }
 
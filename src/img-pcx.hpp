@@ -22,6 +22,7 @@
 #define _CAMOTO_IMG_PCX_HPP_
 
 #include <camoto/gamegraphics/imagetype.hpp>
+#include "header-cache.hpp"
 
 namespace camoto {
 namespace gamegraphics {
@@ -148,14 +149,100 @@ class Image_PCX: virtual public Image
 
 		virtual Caps caps() const;
 		virtual ColourDepth colourDepth() const;
+		virtual MaskKind maskKind() const;
 		virtual Point dimensions() const;
 		virtual void dimensions(const Point& newDimensions);
-		virtual Pixels convert() const;
-		virtual Pixels convert_mask() const;
+		using Image::convert;
+		virtual void convertInto(uint8_t *pixels, uint8_t *mask, size_t stride)
+			const;
+		virtual Pixels convert(const Rect& region) const;
+		virtual void decodeRows(fn_image_row fnRow) const;
 		virtual void convert(const Pixels& newContent,
 			const Pixels& newMask);
+		virtual void convert(const Rect& region, const Pixels& newContent,
+			const Pixels& newMask);
+		virtual stream::len encodedSize(const Pixels& newContent,
+			const Pixels& newMask) const;
+		virtual void dropCache();
 
 	protected:
+		/// Decode scanlines up to but not including endRow.
+		/**
+		 * @param pixels
+		 *   Destination for row firstRow.  Earlier rows are decoded but discarded,
+		 *   as the RLE data must be processed in order.  May be nullptr, in which
+		 *   case each row is decoded into a temporary buffer and only passed to
+		 *   fnRow.
+		 *
+		 * @param stride
+		 *   Distance between rows in pixels, in bytes.
+		 *
+		 * @param firstRow
+		 *   First row to write into pixels.
+		 *
+		 * @param endRow
+		 *   Decoding stops before this row.
+		 *
+		 * @param fnRow
+		 *   Optional callback, run as each row from firstRow onwards is completed.
+		 */
+		void decodeScanlines(uint8_t *pixels, size_t stride, unsigned int firstRow,
+			unsigned int endRow, fn_image_row fnRow = nullptr) const;
+
+		/// Length of each scanline, from the file header.
+		int16_t scanlineLength() const;
+
+		/// Length of the pixel data, excluding the header and any VGA palette.
+		stream::len pixelDataLength() const;
+
+		/// Find where a range of scanlines is stored in the pixel data.
+		/**
+		 * @param firstRow
+		 *   First scanline in the range.
+		 *
+		 * @param endRow
+		 *   Scanline following the last one in the range.
+		 *
+		 * @param bytesPerScanline
+		 *   Decoded length of each scanline.
+		 *
+		 * @param offStart
+		 *   On return, offset of firstRow relative to the start of the pixel
+		 *   data.
+		 *
+		 * @param offEnd
+		 *   On return, offset of endRow relative to the start of the pixel data.
+		 *
+		 * @return true if the range was found, false if the data ends first or
+		 *   an RLE code spans the start or end of the range.
+		 */
+		bool findScanlines(unsigned int firstRow, unsigned int endRow,
+			unsigned int bytesPerScanline, stream::pos *offStart,
+			stream::pos *offEnd) const;
+
+		/// Number of bytes in each scanline when writing an image of this size.
+		unsigned int encodedScanlineLength(const Point& dims) const;
+
+		/// Write the pixel data for a run of scanlines.
+		/**
+		 * @param out
+		 *   Destination for the pixel data.  If RLE is in use this must be a
+		 *   filtered stream that will perform the compression.
+		 *
+		 * @param pixels
+		 *   Image data, in the standard 8bpp indexed format, starting at the first
+		 *   row to write.
+		 *
+		 * @param numRows
+		 *   Number of rows to write.
+		 *
+		 * @param bytesPerScanline
+		 *   Value from encodedScanlineLength().
+		 */
+		void encodeScanlines(std::shared_ptr<stream::output> out,
+			const uint8_t *pixels, unsigned int numRows,
+			unsigned int bytesPerScanline) const;
+
 		std::shared_ptr<stream::inout> content;
 		uint8_t ver;
 		uint8_t encoding;
@@ -163,6 +250,13 @@ class Image_PCX: virtual public Image
 		uint8_t numPlanes;
 		bool useRLE;
 		Point dims;
+
+		/// Length of each scanline, from the file header
+		mutable HeaderCache<int16_t> hdrBytesPerScanline;
+
+		/// Length of the (possibly RLE-encoded) pixel data, excluding any VGA
+		/// palette at the end of the file
+		mutable HeaderCache<stream::len> lenPixelData;
 };
 
 } // namespace gamegraphics
@@ -20,6 +20,7 @@
 
 #include <camoto/iostream_helpers.hpp>
 #include <camoto/util.hpp> // make_unique
+#include "header-cache.hpp"
 #include "img-pic-raptor.hpp"
 #include "pal-vga-raw.hpp"
 
@@ -54,6 +55,10 @@ class Image_RaptorPIC: virtual public Image_VGA
 		virtual Caps caps() const;
 		virtual Point dimensions() const;
 		virtual void dimensions(const Point& newDimensions);
+		virtual void dropCache();
+
+	protected:
+		mutable HeaderCache<Point> hdrDims; ///< Dimensions from the file header
 };
 
 
@@ -171,13 +176,15 @@ Image::Caps Image_RaptorPIC::caps() const
 
 Point Image_RaptorPIC::dimensions() const
 {
-	Point dims;
-	this->content->seekg(12, stream::start);
-	*this->content
-		>> u32le(dims.x)
-		>> u32le(dims.y)
-	;
-	return dims;
+	return this->hdrDims.get([this]() {
+		Point dims;
+		this->content->seekg(12, stream::start);
+		*this->content
+			>> u32le(dims.x)
+			>> u32le(dims.y)
+		;
+		return dims;
+	});
 }
 
 void Image_RaptorPIC::dimensions(const Point& newDimensions)
@@ -188,6 +195,14 @@ void Image_RaptorPIC::dimensions(const Point& newDimensions)
 		<< u32le(newDimensions.x)
 		<< u32le(newDimensions.y)
 	;
+	this->hdrDims.set(newDimensions);
+	return;
+}
+
+void Image_RaptorPIC::dropCache()
+{
+	this->hdrDims.invalidate();
+	this->Image_VGA::dropCache();
 	return;
 }
 
@@ -53,10 +53,12 @@ class Image_SW93Beta_BG_Planar: virtual public Image
 
 		virtual Caps caps() const;
 		virtual ColourDepth colourDepth() const;
+		virtual MaskKind maskKind() const;
 		virtual Point dimensions() const;
-		virtual Pixels convert() const;
-		virtual Pixels convert_mask() const;
+		using Image::convert;
 		virtual void convert(const Pixels& newContent, const Pixels& newMask);
+		virtual void convertInto(uint8_t *pixels, uint8_t *mask, size_t stride)
+			const;
 
 	protected:
 		std::unique_ptr<stream::inout> content[4]; ///< Image content
@@ -180,37 +182,38 @@ ColourDepth Image_SW93Beta_BG_Planar::colourDepth() const
 	return ColourDepth::VGA;
 }
 
+Image::MaskKind Image_SW93Beta_BG_Planar::maskKind() const
+{
+	return MaskKind::Opaque;
+}
+
 Point Image_SW93Beta_BG_Planar::dimensions() const
 {
 	return Point{SWBGP_WIDTH * 4, SWBGP_HEIGHT};
 }
 
-Pixels Image_SW93Beta_BG_Planar::convert() const
+void Image_SW93Beta_BG_Planar::convertInto(uint8_t *pixels, uint8_t *mask,
+	size_t stride) const
 {
-	Pixels src, dst;
-	dst.resize(SWBGP_WIDTH * SWBGP_HEIGHT * 4, 0);
+	// Return an entirely opaque mask
+	if (mask) this->fillRows(mask, stride, this->dimensions(), 0x00);
+	if (!pixels) return;
 
+	uint8_t src[SWBGP_WIDTH];
 	for (unsigned int p = 0; p < 4; p++) {
 		this->content[p]->seekg(0, stream::start);
 
-		for (unsigned int y = 0; y < SWBGP_WIDTH * 4 * SWBGP_HEIGHT; y += SWBGP_WIDTH * 4) {
-			for (unsigned long x = p; x < SWBGP_WIDTH * 4; x += 4) {
-				*this->content[p] >> u8(dst[y + x]);
+		for (unsigned int y = 0; y < SWBGP_HEIGHT; y++) {
+			// Read one row of this plane, then spread it across every fourth pixel
+			this->content[p]->read(src, SWBGP_WIDTH);
+			auto row = pixels + y * stride;
+			for (unsigned long x = 0; x < SWBGP_WIDTH; x++) {
+				row[x * 4 + p] = src[x];
 			}
 		}
 	}
 
-	return dst;
-}
-
-Pixels Image_SW93Beta_BG_Planar::convert_mask() const
-{
-	int dataSize = SWBGP_WIDTH * SWBGP_HEIGHT * 4;
-
-	// Return an entirely opaque mask
-	Pixels pix;
-	pix.resize(dataSize, 0);
-	return pix;
+	return;
 }
 
 void Image_SW93Beta_BG_Planar::convert(const Pixels& newContent,
@@ -50,11 +50,13 @@ class Image_SW93Beta_Planar: virtual public Image
 
 		virtual Caps caps() const;
 		virtual ColourDepth colourDepth() const;
+		virtual MaskKind maskKind() const;
 		virtual Point dimensions() const;
 		virtual void dimensions(const Point& newDimensions);
-		virtual Pixels convert() const;
-		virtual Pixels convert_mask() const;
+		using Image::convert;
 		virtual void convert(const Pixels& newContent, const Pixels& newMask);
+		virtual void convertInto(uint8_t *pixels, uint8_t *mask, size_t stride)
+			const;
 
 	protected:
 		std::unique_ptr<stream::inout> content; ///< Image content
@@ -199,6 +201,11 @@ ColourDepth Image_SW93Beta_Planar::colourDepth() const
 	return ColourDepth::VGA;
 }
 
+Image::MaskKind Image_SW93Beta_Planar::maskKind() const
+{
+	return MaskKind::Opaque;
+}
+
 Point Image_SW93Beta_Planar::dimensions() const
 {
 	return this->dims;
@@ -213,10 +220,16 @@ void Image_SW93Beta_Planar::dimensions(const Point& newDimensions)
 	return;
 }
 
-Pixels Image_SW93Beta_Planar::convert() const
+void Image_SW93Beta_Planar::convertInto(uint8_t *pixels, uint8_t *mask,
+	size_t stride) const
 {
-	Pixels src, dst;
-	dst.resize(this->dims.x * this->dims.y, 0);
+	// Return an entirely opaque mask
+	if (mask) this->fillRows(mask, stride, this->dims, 0x00);
+	if (!pixels) return;
+
+	this->fillRows(pixels, stride, this->dims, 0x00);
+
+	Pixels src;
 
 	// Return to start of first plane
 	this->content->seekg(3, stream::start);
@@ -231,25 +244,16 @@ Pixels Image_SW93Beta_Planar::convert() const
 
 		// Convert the planar data to linear
 		for (unsigned int y = 0; y < this->dims.y; y++) {
+			auto row = pixels + y * stride;
 			for (unsigned int x = 0; x < planeWidth; x++) {
-				long d = y * this->dims.x + x * 4 + p;
-				if (d > this->dims.x * this->dims.y) break; // corrupt data
-				dst[d] = src[y * planeWidth + x];
+				long d = x * 4 + p;
+				if (d >= this->dims.x) break; // corrupt data
+				row[d] = src[y * planeWidth + x];
 			}
 		}
 	}
 
-	return dst;
-}
-
-Pixels Image_SW93Beta_Planar::convert_mask() const
-{
-	int dataSize = this->dims.x * this->dims.y;
-
-	// Return an entirely opaque mask
-	Pixels pix;
-	pix.resize(dataSize, 0);
-	return pix;
+	return;
 }
 
 void Image_SW93Beta_Planar::convert(const Pixels& newContent,
@@ -19,6 +19,7 @@
  */
 
 #include <cassert>
+#include "content-hash.hpp"
 #include "img-vga-planar.hpp"
 
 namespace camoto {
@@ -45,14 +46,25 @@ ColourDepth Image_VGA_Planar::colourDepth() const
 	return ColourDepth::VGA;
 }
 
-Pixels Image_VGA_Planar::convert() const
+Image::MaskKind Image_VGA_Planar::maskKind() const
+{
+	return MaskKind::Opaque;
+}
+
+void Image_VGA_Planar::convertInto(uint8_t *pixels, uint8_t *mask,
+	size_t stride) const
 {
 	auto dims = this->dimensions();
+	assert(stride >= (size_t)dims.x);
+
+	// Return an entirely opaque mask
+	if (mask) this->fillRows(mask, stride, dims, 0x00);
+	if (!pixels) return;
+
 	unsigned long dataSize = dims.x * dims.y;
 
-	Pixels src, dst;
+	Pixels src;
 	src.resize(dataSize, 0);
-	dst.resize(dataSize, 0);
 
 	this->content->seekg(this->off, stream::start);
 	this->content->read(src.data(), dataSize);
@@ -61,21 +73,11 @@ Pixels Image_VGA_Planar::convert() const
 	unsigned int planeWidth = dims.x / 4;
 	unsigned int planeSize = planeWidth * dims.y;
 	for (unsigned int i = 0; i < dataSize; i++) {
-		dst[i % planeSize * 4 + i / planeSize] = src[i];
+		unsigned int j = i % planeSize * 4 + i / planeSize;
+		pixels[j / dims.x * stride + j % dims.x] = src[i];
 	}
 
-	return dst;
-}
-
-Pixels Image_VGA_Planar::convert_mask() const
-{
-	auto dims = this->dimensions();
-	int dataSize = dims.x * dims.y;
-
-	// Return an entirely opaque mask
-	Pixels pix;
-	pix.resize(dataSize, 0);
-	return pix;
+	return;
 }
 
 void Image_VGA_Planar::convert(const Pixels& newContent,
@@ -107,5 +109,72 @@ void Image_VGA_Planar::convert(const Pixels& newContent,
 	return;
 }
 
+void Image_VGA_Planar::convert(const Rect& region, const Pixels& newContent,
+	const Pixels& newMask)
+{
+	this->checkRegion(region);
+	auto dims = this->dimensions();
+	unsigned long dataSize = dims.x * dims.y;
+
+	// Write out the whole image if it isn't there to be patched yet, or if the
+	// rows don't split evenly across the planes.
+	if ((dims.x % 4) || (this->content->size() < dataSize + this->off)) {
+		this->Image::convert(region, newContent, newMask);
+		return;
+	}
+	if ((region.width == 0) || (region.height == 0)) return;
+
+	// Every fourth pixel in a row is in the same plane, so the region covers a
+	// run of consecutive bytes in each row of each plane.
+	unsigned int planeWidth = dims.x / 4;
+	unsigned int planeSize = planeWidth * dims.y;
+	Pixels span;
+	for (unsigned int p = 0; p < 4; p++) {
+		long firstX = region.x + (p + 4 - region.x % 4) % 4;
+		if (firstX >= region.x + region.width) continue;
+		long lenSpan = (region.x + region.width - 1 - firstX) / 4 + 1;
+		span.resize(lenSpan);
+		for (long y = 0; y < region.height; y++) {
+			auto src = &newContent[y * region.width + firstX - region.x];
+			for (long i = 0; i < lenSpan; i++) span[i] = src[i * 4];
+			this->content->seekp(this->off + p * planeSize
+				+ (region.y + y) * planeWidth + firstX / 4, stream::start);
+			this->content->write(span.data(), lenSpan);
+		}
+	}
+	this->content->flush();
+	return;
+}
+
+stream::len Image_VGA_Planar::encodedSize(const Pixels& newContent,
+	const Pixels& newMask) const
+{
+	auto dims = this->dimensions();
+	return this->off + dims.x * dims.y;
+}
+
+uint64_t Image_VGA_Planar::contentHash() const
+{
+	auto dims = this->dimensions();
+	ContentHash hash(ContentHash::Domain::Encoded, dims);
+	hash.add(*this->content, this->off, dims.x * dims.y);
+	return hash.value();
+}
+
+bool Image_VGA_Planar::isUniform(uint8_t *colour, uint8_t *mask) const
+{
+	auto dims = this->dimensions();
+	if ((dims.x == 0) || (dims.y == 0)) return false;
+
+	// One byte per pixel, so the image is uniform if the bytes are
+	uint8_t value;
+	if (!Image::allSame(*this->content, this->off, dims.x * dims.y, &value)) {
+		return false;
+	}
+	if (colour) *colour = value;
+	if (mask) *mask = 0x00;
+	return true;
+}
+
 } // namespace gamegraphics
 } // namespace camoto
@@ -31,6 +31,8 @@ namespace gamegraphics {
  * This class adds support for converting to and from planar VGA mode formats.
  * It does not handle image size (dimensions) so it should be inherited by more
  * specific format handlers.
+ *
+ * contentHash() hashes the stored plane data (the encoded domain).
  */
 class Image_VGA_Planar: virtual public Image
 {
@@ -48,9 +50,17 @@ class Image_VGA_Planar: virtual public Image
 
 		virtual Caps caps() const;
 		virtual ColourDepth colourDepth() const;
-		virtual Pixels convert() const;
-		virtual Pixels convert_mask() const;
+		virtual MaskKind maskKind() const;
+		using Image::convert;
 		virtual void convert(const Pixels& newContent, const Pixels& newMask);
+		virtual void convert(const Rect& region, const Pixels& newContent,
+			const Pixels& newMask);
+		virtual stream::len encodedSize(const Pixels& newContent,
+			const Pixels& newMask) const;
+		virtual uint64_t contentHash() const;
+		virtual bool isUniform(uint8_t *colour, uint8_t *mask = nullptr) const;
+		virtual void convertInto(uint8_t *pixels, uint8_t *mask, size_t stride)
+			const;
 
 	protected:
 		std::unique_ptr<stream::inout> content; ///< Image content
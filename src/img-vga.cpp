@@ -20,6 +20,7 @@
 
 #include <cassert>
 #include <camoto/util.hpp>
+#include "content-hash.hpp"
 #include "img-vga.hpp"
 
 namespace camoto {
@@ -46,9 +47,21 @@ ColourDepth Image_VGA::colourDepth() const
 	return ColourDepth::VGA;
 }
 
-Pixels Image_VGA::convert() const
+Image::MaskKind Image_VGA::maskKind() const
+{
+	return MaskKind::Opaque;
+}
+
+void Image_VGA::convertInto(uint8_t *pixels, uint8_t *mask, size_t stride)
+	const
 {
 	auto dims = this->dimensions();
+	assert(stride >= (size_t)dims.x);
+
+	// Return an entirely opaque mask
+	if (mask) this->fillRows(mask, stride, dims, 0x00);
+	if (!pixels) return;
+
 	unsigned long dataSize = dims.x * dims.y;
 
 	// Safety check to ensure supplied stream is long enough
@@ -59,22 +72,68 @@ Pixels Image_VGA::convert() const
 			<< streamSize << " bytes long."));
 	}
 
-	Pixels pix;
-	pix.resize(dataSize);
 	this->content->seekg(this->off, stream::start);
-	this->content->read(pix.data(), dataSize);
-	return pix;
+	if (stride == (size_t)dims.x) {
+		// No padding between rows, so read the whole image in one go
+		this->content->read(pixels, dataSize);
+	} else {
+		for (long y = 0; y < dims.y; y++) {
+			this->content->read(pixels + y * stride, dims.x);
+		}
+	}
+	return;
 }
 
-Pixels Image_VGA::convert_mask() const
+Pixels Image_VGA::convert(const Rect& region) const
 {
+	this->checkRegion(region);
 	auto dims = this->dimensions();
-	int dataSize = dims.x * dims.y;
+
+	// Each row is stored as-is, so we can seek straight to the part we want
+	Pixels pixels(region.width * region.height);
+	auto dst = pixels.data();
+	for (long y = 0; y < region.height; y++) {
+		this->content->seekg(this->off + (region.y + y) * dims.x + region.x,
+			stream::start);
+		this->content->read(dst, region.width);
+		dst += region.width;
+	}
+	return pixels;
+}
+
+Pixels Image_VGA::convertPreview(unsigned int shift) const
+{
+	auto dims = this->dimensions();
+	auto dimsPreview = this->previewDimensions(shift);
+
+	// Seek straight to each row that will be sampled, skipping the rest
+	Pixels pixels(dimsPreview.x * dimsPreview.y);
+	Pixels row(dims.x);
+	auto dst = pixels.data();
+	for (long y = 0; y < dimsPreview.y; y++) {
+		this->content->seekg(this->off + (y << shift) * dims.x, stream::start);
+		this->content->read(row.data(), dims.x);
+		for (long x = 0; x < dimsPreview.x; x++) {
+			*dst++ = row[x << shift];
+		}
+	}
+	return pixels;
+}
+
+void Image_VGA::decodeRows(fn_image_row fnRow) const
+{
+	auto dims = this->dimensions();
+	Pixels row(dims.x);
 
 	// Return an entirely opaque mask
-	Pixels pix;
-	pix.resize(dataSize, 0);
-	return pix;
+	Pixels rowMask(dims.x, 0x00);
+
+	this->content->seekg(this->off, stream::start);
+	for (long y = 0; y < dims.y; y++) {
+		this->content->read(row.data(), dims.x);
+		fnRow(y, row.data(), rowMask.data());
+	}
+	return;
 }
 
 void Image_VGA::convert(const Pixels& newContent,
@@ -97,5 +156,62 @@ void Image_VGA::convert(const Pixels& newContent,
 	return;
 }
 
+void Image_VGA::convert(const Rect& region, const Pixels& newContent,
+	const Pixels& newMask)
+{
+	this->checkRegion(region);
+	auto dims = this->dimensions();
+	stream::len dataSize = dims.x * dims.y;
+
+	stream::pos len = this->content->size();
+
+	// Write out the whole image if it isn't there to be patched yet
+	if (len < dataSize + this->off) {
+		this->Image::convert(region, newContent, newMask);
+		return;
+	}
+
+	// Overwrite only the part of each row covered by the region
+	auto src = newContent.data();
+	for (long y = 0; y < region.height; y++) {
+		this->content->seekp(this->off + (region.y + y) * dims.x + region.x,
+			stream::start);
+		this->content->write(src, region.width);
+		src += region.width;
+	}
+	this->content->flush();
+	return;
+}
+
+stream::len Image_VGA::encodedSize(const Pixels& newContent,
+	const Pixels& newMask) const
+{
+	auto dims = this->dimensions();
+	return this->off + dims.x * dims.y;
+}
+
+uint64_t Image_VGA::contentHash() const
+{
+	auto dims = this->dimensions();
+	ContentHash hash(ContentHash::Domain::Encoded, dims);
+	hash.add(*this->content, this->off, dims.x * dims.y);
+	return hash.value();
+}
+
+bool Image_VGA::isUniform(uint8_t *colour, uint8_t *mask) const
+{
+	auto dims = this->dimensions();
+	if ((dims.x == 0) || (dims.y == 0)) return false;
+
+	// One byte per pixel, so the image is uniform if the bytes are
+	uint8_t value;
+	if (!Image::allSame(*this->content, this->off, dims.x * dims.y, &value)) {
+		return false;
+	}
+	if (colour) *colour = value;
+	if (mask) *mask = 0x00;
+	return true;
+}
+
 } // namespace gamegraphics
 } // namespace camoto
@@ -32,6 +32,8 @@ namespace gamegraphics {
  * This class adds support for converting to and from VGA mode 13 format.  It
  * does not handle image size (dimensions) so it should be inherited by more
  * specific format handlers.
+ *
+ * contentHash() hashes the stored pixel bytes (the encoded domain).
  */
 class CAMOTO_GAMEGRAPHICS_API Image_VGA: virtual public Image
 {
@@ -49,9 +51,20 @@ class CAMOTO_GAMEGRAPHICS_API Image_VGA: virtual public Image
 
 		virtual Caps caps() const;
 		virtual ColourDepth colourDepth() const;
-		virtual Pixels convert() const;
-		virtual Pixels convert_mask() const;
+		virtual MaskKind maskKind() const;
+		using Image::convert;
+		virtual Pixels convert(const Rect& region) const;
+		virtual Pixels convertPreview(unsigned int shift) const;
 		virtual void convert(const Pixels& newContent, const Pixels& newMask);
+		virtual void convert(const Rect& region, const Pixels& newContent,
+			const Pixels& newMask);
+		virtual stream::len encodedSize(const Pixels& newContent,
+			const Pixels& newMask) const;
+		virtual uint64_t contentHash() const;
+		virtual bool isUniform(uint8_t *colour, uint8_t *mask = nullptr) const;
+		virtual void convertInto(uint8_t *pixels, uint8_t *mask, size_t stride)
+			const;
+		virtual void decodeRows(fn_image_row fnRow) const;
 
 	protected:
 		std::unique_ptr<stream::inout> content; ///< Image content
@@ -209,6 +209,11 @@ ColourDepth Image_Zone66Tile::colourDepth() const
 	return ColourDepth::VGA;
 }
 
+Image::MaskKind Image_Zone66Tile::maskKind() const
+{
+	return MaskKind::Opaque;
+}
+
 Point Image_Zone66Tile::dimensions() const
 {
 	return this->dims;
@@ -235,19 +240,28 @@ void Image_Zone66Tile::dimensions(const Point& newDimensions)
 	return;
 }
 
-Pixels Image_Zone66Tile::convert() const
+void Image_Zone66Tile::convertInto(uint8_t *pixels, uint8_t *mask,
+	size_t stride) const
 {
 	auto dims = this->dimensions();
-	Pixels imgData(dims.x * dims.y, 0x00);
+	assert(stride >= (size_t)dims.x);
+
+	// Return an entirely opaque mask
+	if (mask) this->fillRows(mask, stride, dims, 0x00);
+	if (!pixels) return;
 
 	// Full screen images are in a different format, so should never end up here.
 	// The tls-zone66 handler should create an Image_VGARaw for those tiles
 	// instead.
 	assert((dims.x != 320) && (dims.y != 200));
 
+	// Skipped pixels are left as zero
+	this->fillRows(pixels, stride, dims, 0x00);
+
+	unsigned long dataSize = dims.x * dims.y;
 	this->content->seekg(Z66_IMG_OFFSET, stream::start);
 	unsigned int y = 0;
-	for (unsigned int i = 0; i < imgData.size(); ) {
+	for (unsigned long i = 0; i < dataSize; ) {
 		uint8_t code;
 		*this->content >> u8(code);
 		switch (code) {
@@ -262,30 +276,98 @@ Pixels Image_Zone66Tile::convert() const
 				break;
 
 			case 0xFF: // End of image
-				i = imgData.size();
+				i = dataSize;
 				break;
 
 			case 0x00: // shouldn't happen
 				throw stream::error("corrupted data");
 
 			default:
-				if (i + code <= imgData.size()) {
-					this->content->read(&imgData[i], code);
-					i += code;
-				} else {
+				if (i + code > dataSize) {
 					throw stream::error("bad data, tried to write past end of image");
 				}
+				// The run can wrap onto the following row, so copy it in pieces that
+				// don't cross the end of a row.
+				while (code) {
+					unsigned long col = i % dims.x;
+					unsigned long len = std::min<unsigned long>(code, dims.x - col);
+					this->content->read(pixels + i / dims.x * stride + col, len);
+					i += len;
+					code -= len;
+				}
 				break;
 		}
 	}
-	return imgData;
+	return;
 }
 
-Pixels Image_Zone66Tile::convert_mask() const
+void Image_Zone66Tile::decodeRows(fn_image_row fnRow) const
 {
-	// Return an entirely opaque mask
 	auto dims = this->dimensions();
-	return Pixels(dims.x * dims.y, 0x00);
+
+	// Full screen images are in a different format, so should never end up here.
+	assert((dims.x != 320) && (dims.y != 200));
+
+	// Skipped pixels are left as zero
+	Pixels row(dims.x, 0x00);
+
+	// Return an entirely opaque mask
+	Pixels rowMask(dims.x, 0x00);
+
+	// Pass each finished row to the callback, up to the row containing pos
+	long rowNext = 0;
+	auto finishRows = [&](unsigned long pos) {
+		while ((rowNext < dims.y) && ((unsigned long)(rowNext + 1) * dims.x <= pos)) {
+			fnRow(rowNext++, row.data(), rowMask.data());
+			std::fill(row.begin(), row.end(), 0x00);
+		}
+	};
+
+	unsigned long dataSize = dims.x * dims.y;
+	this->content->seekg(Z66_IMG_OFFSET, stream::start);
+	unsigned int y = 0;
+	for (unsigned long i = 0; i < dataSize; ) {
+		uint8_t code;
+		*this->content >> u8(code);
+		switch (code) {
+			case 0xFD: // Skip the given number of pixels
+				*this->content >> u8(code);
+				i += code;
+				// Note: i may now be >= dataSize
+				break;
+
+			case 0xFE: // Go to the next line
+				i = ++y * dims.x;
+				if (i < (unsigned long)rowNext * dims.x) {
+					// Can't go back to a row that has already been returned
+					throw stream::error("corrupted data");
+				}
+				break;
+
+			case 0xFF: // End of image
+				i = dataSize;
+				break;
+
+			case 0x00: // shouldn't happen
+				throw stream::error("corrupted data");
+
+			default:
+				if (i + code > dataSize) {
+					throw stream::error("bad data, tried to write past end of image");
+				}
+				while (code) {
+					finishRows(i);
+					unsigned long col = i % dims.x;
+					unsigned long len = std::min<unsigned long>(code, dims.x - col);
+					this->content->read(&row[col], len);
+					i += len;
+					code -= len;
+				}
+				break;
+		}
+	}
+	finishRows(dataSize);
+	return;
 }
 
 void Image_Zone66Tile::convert(const Pixels& newContent, const Pixels& newMask)
@@ -58,10 +58,13 @@ class Image_Zone66Tile: virtual public Image
 
 		virtual Caps caps() const;
 		virtual ColourDepth colourDepth() const;
+		virtual MaskKind maskKind() const;
 		virtual Point dimensions() const;
 		virtual void dimensions(const Point& newDimensions);
-		virtual Pixels convert() const;
-		virtual Pixels convert_mask() const;
+		using Image::convert;
+		virtual void convertInto(uint8_t *pixels, uint8_t *mask, size_t stride)
+			const;
+		virtual void decodeRows(fn_image_row fnRow) const;
 		virtual void convert(const Pixels& newContent,
 			const Pixels& newMask);
 
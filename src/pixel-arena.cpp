@@ -0,0 +1,101 @@
+/**
+ * @file  pixel-arena.cpp
+ * @brief Custom memory allocation for pixel buffers.
+ *
+ * Copyright (C) 2010-2017 Adam Nielsen <malvineous@shikadi.net>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <camoto/gamegraphics/pixel-arena.hpp>
+
+/// Alignment of each allocation, enough for any type
+#define ARENA_ALIGN alignof(std::max_align_t)
+
+namespace camoto {
+namespace gamegraphics {
+
+/// Arena in use by each thread, or nullptr for the heap
+static thread_local PixelArena *currentArena = nullptr;
+
+PixelArena::~PixelArena()
+{
+}
+
+PixelArena *PixelArena::current()
+{
+	return currentArena;
+}
+
+PixelArenaScope::PixelArenaScope(PixelArena *arena)
+	:	prev(currentArena)
+{
+	currentArena = arena;
+}
+
+PixelArenaScope::~PixelArenaScope()
+{
+	currentArena = this->prev;
+}
+
+MonotonicPixelArena::MonotonicPixelArena(std::size_t blockSize)
+	:	blockSize(blockSize),
+		next(nullptr),
+		remaining(0)
+{
+}
+
+MonotonicPixelArena::~MonotonicPixelArena()
+{
+}
+
+void *MonotonicPixelArena::allocate(std::size_t len)
+{
+	// Round up so the next allocation stays aligned
+	std::size_t lenAligned = (len + ARENA_ALIGN - 1) / ARENA_ALIGN * ARENA_ALIGN;
+	if (lenAligned == 0) lenAligned = ARENA_ALIGN;
+
+	if (lenAligned > this->remaining) {
+		if (lenAligned > this->blockSize) {
+			// Too big to share a block, so give it one of its own but keep using
+			// the current block for later allocations.
+			this->blocks.emplace_back(new uint8_t[lenAligned]);
+			return this->blocks.back().get();
+		}
+		this->blocks.emplace_back(new uint8_t[this->blockSize]);
+		this->next = this->blocks.back().get();
+		this->remaining = this->blockSize;
+	}
+	void *ptr = this->next;
+	this->next += lenAligned;
+	this->remaining -= lenAligned;
+	return ptr;
+}
+
+void MonotonicPixelArena::deallocate(void *ptr, std::size_t len)
+{
+	std::size_t lenAligned = (len + ARENA_ALIGN - 1) / ARENA_ALIGN * ARENA_ALIGN;
+	if (lenAligned == 0) lenAligned = ARENA_ALIGN;
+
+	// If this was the last thing allocated from the current block, it can be
+	// handed out again.  Anything else is only freed with the arena.
+	if ((uint8_t *)ptr + lenAligned == this->next) {
+		this->next = (uint8_t *)ptr;
+		this->remaining += lenAligned;
+	}
+	return;
+}
+
+} // namespace gamegraphics
+} // namespace camoto
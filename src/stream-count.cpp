@@ -0,0 +1,98 @@
+/**
+ * @file  stream-count.cpp
+ * @brief Stream that discards its data, keeping only the length.
+ *
+ * Copyright (C) 2010-2017 Adam Nielsen <malvineous@shikadi.net>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include "stream-count.hpp"
+
+namespace camoto {
+namespace gamegraphics {
+
+stream_count::stream_count()
+	:	offset(0),
+		lenData(0)
+{
+}
+
+stream_count::~stream_count()
+{
+}
+
+stream::len stream_count::try_read(uint8_t *buffer, stream::len len)
+{
+	// There is never any data to read
+	return 0;
+}
+
+void stream_count::seekg(stream::delta off, stream::seek_from from)
+{
+	this->seekp(off, from);
+	return;
+}
+
+stream::pos stream_count::tellg() const
+{
+	return this->offset;
+}
+
+stream::len stream_count::size() const
+{
+	return this->lenData;
+}
+
+stream::len stream_count::try_write(const uint8_t *buffer, stream::len len)
+{
+	this->offset += len;
+	this->lenData = std::max(this->lenData, this->offset);
+	return len;
+}
+
+void stream_count::seekp(stream::delta off, stream::seek_from from)
+{
+	stream::delta base = 0;
+	switch (from) {
+		case stream::start: base = 0; break;
+		case stream::cur: base = this->offset; break;
+		case stream::end: base = this->lenData; break;
+	}
+	if (base + off < 0) {
+		throw stream::seek_error("Cannot seek back past start of stream.");
+	}
+	this->offset = base + off;
+	return;
+}
+
+stream::pos stream_count::tellp() const
+{
+	return this->offset;
+}
+
+void stream_count::truncate(stream::pos size)
+{
+	this->lenData = size;
+	return;
+}
+
+void stream_count::flush()
+{
+	return;
+}
+
+} // namespace gamegraphics
+} // namespace camoto
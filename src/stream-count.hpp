@@ -0,0 +1,64 @@
+/**
+ * @file  stream-count.hpp
+ * @brief Stream that discards its data, keeping only the length.
+ *
+ * Copyright (C) 2010-2017 Adam Nielsen <malvineous@shikadi.net>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CAMOTO_STREAM_COUNT_HPP_
+#define _CAMOTO_STREAM_COUNT_HPP_
+
+#include <camoto/stream.hpp>
+
+namespace camoto {
+namespace gamegraphics {
+
+/// Stream that throws away everything written to it.
+/**
+ * The data is not stored, but the seek position and length are tracked as if
+ * it were, so after writing an image to this stream size() returns the number
+ * of bytes it would have taken up.  This is used to calculate the size of
+ * compressed images (see Image::encodedSize()) by running the usual encoder
+ * with this as the final destination.
+ *
+ * The stream starts off empty, and reading from it always returns zero bytes.
+ */
+class stream_count: virtual public stream::inout
+{
+	public:
+		stream_count();
+		virtual ~stream_count();
+
+		virtual stream::len try_read(uint8_t *buffer, stream::len len);
+		virtual void seekg(stream::delta off, stream::seek_from from);
+		virtual stream::pos tellg() const;
+		virtual stream::len size() const;
+
+		virtual stream::len try_write(const uint8_t *buffer, stream::len len);
+		virtual void seekp(stream::delta off, stream::seek_from from);
+		virtual stream::pos tellp() const;
+		virtual void truncate(stream::pos size);
+		virtual void flush();
+
+	protected:
+		stream::pos offset; ///< Current seek position
+		stream::len lenData; ///< Number of bytes that would be in the stream
+};
+
+} // namespace gamegraphics
+} // namespace camoto
+
+#endif // _CAMOTO_STREAM_COUNT_HPP_
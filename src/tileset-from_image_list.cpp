@@ -232,8 +232,9 @@ std::unique_ptr<Image> Tileset_FromImageList::openImage(const FileHandle& id)
 					}
 					auto this_shared = this->shared_from_this();
 					if (!item.stdImg) {
-						item.stdImg = std::make_shared<Pixels>(item.img->convert());
-						item.stdMask = std::make_shared<Pixels>(item.img->convert_mask());
+						item.stdImg = std::make_shared<Pixels>();
+						item.stdMask = std::make_shared<Pixels>();
+						item.img->convertBoth(*item.stdImg, *item.stdMask);
 					}
 					auto dimsImg = item.img->dimensions();
 					Rect rectFull{0, 0, dimsImg.x, dimsImg.y};
@@ -253,8 +254,9 @@ std::unique_ptr<Image> Tileset_FromImageList::openImage(const FileHandle& id)
 				case Item::SplitType::List: {
 					auto this_shared = this->shared_from_this();
 					if (!item.stdImg) {
-						item.stdImg = std::make_shared<Pixels>(item.img->convert());
-						item.stdMask = std::make_shared<Pixels>(item.img->convert_mask());
+						item.stdImg = std::make_shared<Pixels>();
+						item.stdMask = std::make_shared<Pixels>();
+						item.img->convertBoth(*item.stdImg, *item.stdMask);
 					}
 					return std::make_unique<Image_Sub>(item.stdImg, item.stdMask,
 						item.img->dimensions(), fat->dims, item.img->colourDepth(),
@@ -50,6 +50,14 @@ std::unique_ptr<Image> Tileset::openImage(const FileHandle& id)
 		" attributes to detect this).");
 }
 
+std::future<std::unique_ptr<Image>> Tileset::openImageAsync(
+	const FileHandle& id, Executor& exec)
+{
+	return submitTask<std::unique_ptr<Image>>(exec, [this, id]() {
+		return this->openImage(id);
+	});
+}
+
 Point Tileset::dimensions() const
 {
 	// Fail if this function is called when the caps say not to
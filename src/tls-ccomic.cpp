@@ -36,6 +36,17 @@ namespace gamegraphics {
 
 #define FILETYPE_CCOMIC "tile/ccomic"
 
+constexpr int firstTileOffset(PlaneCount numPlanes)
+{
+	return (numPlanes == PlaneCount::Solid) ? 4 : 0;
+}
+
+/// Size of each tile, in bytes
+constexpr int tileSize(PlaneCount numPlanes)
+{
+	return CCA_TILE_WIDTH / 8 * CCA_TILE_HEIGHT * (int)numPlanes;
+}
+
 class Tileset_CComic:
 	virtual public Tileset_FAT,
 	virtual public Tileset_FAT_FixedTileSize
@@ -128,6 +139,12 @@ SuppFilenames TilesetType_CComic::getRequiredSupps(stream::input& content,
 	return {};
 }
 
+stream::len TilesetType_CComic::estimateSize(unsigned int numImages) const
+{
+	return firstTileOffset(PlaneCount::Solid)
+		+ numImages * tileSize(PlaneCount::Solid);
+}
+
 
 //
 // TilesetType_CComic_Sprite
@@ -165,20 +182,22 @@ std::shared_ptr<Tileset> TilesetType_CComic_Sprite::open(
 	return std::make_shared<Tileset_CComic>(std::move(content), PlaneCount::Masked);
 }
 
+stream::len TilesetType_CComic_Sprite::estimateSize(unsigned int numImages)
+	const
+{
+	return firstTileOffset(PlaneCount::Masked)
+		+ numImages * tileSize(PlaneCount::Masked);
+}
+
 
 //
 // Tileset_CComic
 //
 
-constexpr int firstTileOffset(PlaneCount numPlanes)
-{
-	return (numPlanes == PlaneCount::Solid) ? 4 : 0;
-}
-
 Tileset_CComic::Tileset_CComic(std::unique_ptr<stream::inout> content,
 	PlaneCount numPlanes)
 	:	Tileset_FAT(std::move(content), firstTileOffset(numPlanes), ARCH_NO_FILENAMES),
-		Tileset_FAT_FixedTileSize(CCA_TILE_WIDTH / 8 * CCA_TILE_HEIGHT * (int)numPlanes),
+		Tileset_FAT_FixedTileSize(tileSize(numPlanes)),
 		numPlanes(numPlanes)
 {
 	int tileSize = (int)this->numPlanes << 5; // multiply by 32 (bytes per plane)
@@ -43,6 +43,7 @@ class TilesetType_CComic: virtual public TilesetType
 			std::unique_ptr<stream::inout> content, SuppData& suppData) const;
 		virtual SuppFilenames getRequiredSupps(stream::input& content,
 			const std::string& filename) const;
+		virtual stream::len estimateSize(unsigned int numImages) const;
 };
 
 class TilesetType_CComic_Sprite: virtual public TilesetType_CComic
@@ -55,6 +56,7 @@ class TilesetType_CComic_Sprite: virtual public TilesetType_CComic
 			std::unique_ptr<stream::inout> content, SuppData& suppData) const;
 		virtual std::shared_ptr<Tileset> open(
 			std::unique_ptr<stream::inout> content, SuppData& suppData) const;
+		virtual stream::len estimateSize(unsigned int numImages) const;
 };
 
 } // namespace gamegraphics
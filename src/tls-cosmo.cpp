@@ -135,6 +135,12 @@ SuppFilenames TilesetType_Cosmo::getRequiredSupps(stream::input& content,
 	return {};
 }
 
+stream::len TilesetType_Cosmo::estimateSize(unsigned int numImages) const
+{
+	return Tileset_EGAApogee::fileSize(numImages,
+		Point{CCA_TILE_WIDTH, CCA_TILE_HEIGHT}, PlaneCount::Solid);
+}
+
 
 //
 // TilesetType_CosmoMasked
@@ -169,5 +175,11 @@ std::shared_ptr<Tileset> TilesetType_CosmoMasked::open(
 	);
 }
 
+stream::len TilesetType_CosmoMasked::estimateSize(unsigned int numImages) const
+{
+	return Tileset_EGAApogee::fileSize(numImages,
+		Point{CCA_TILE_WIDTH, CCA_TILE_HEIGHT}, PlaneCount::Masked);
+}
+
 } // namespace gamegraphics
 } // namespace camoto
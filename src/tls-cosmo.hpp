@@ -45,6 +45,7 @@ class TilesetType_Cosmo: virtual public TilesetType
 			std::unique_ptr<stream::inout> content, SuppData& suppData) const;
 		virtual SuppFilenames getRequiredSupps(stream::input& content,
 			const std::string& filename) const;
+		virtual stream::len estimateSize(unsigned int numImages) const;
 };
 
 class TilesetType_CosmoMasked: virtual public TilesetType_Cosmo
@@ -55,6 +56,7 @@ class TilesetType_CosmoMasked: virtual public TilesetType_Cosmo
 		virtual Certainty isInstance(stream::input& content) const;
 		virtual std::shared_ptr<Tileset> open(
 			std::unique_ptr<stream::inout> content, SuppData& suppData) const;
+		virtual stream::len estimateSize(unsigned int numImages) const;
 };
 
 } // namespace gamegraphics
@@ -146,5 +146,15 @@ const Tileset::FileHandle Tileset_EGAApogee::insert(const FileHandle& idBeforeTh
 	return newHandle;
 }
 
+stream::len Tileset_EGAApogee::fileSize(unsigned int numTiles,
+	Point tileDimensions, PlaneCount numPlanes)
+{
+	stream::len lenTiles = numTiles * (tileDimensions.x / 8 * tileDimensions.y
+		* (unsigned int)numPlanes);
+
+	// Add the padding inserted after each complete block
+	return lenTiles + (lenTiles / EGA_APOGEE_PAD_BLOCK) * 15;
+}
+
 } // namespace gamegraphics
 } // namespace camoto
@@ -50,6 +50,22 @@ class Tileset_EGAApogee:
 			File::Attribute attr);
 		using Archive::insert;
 
+		/// Size of a tileset file in this format.
+		/**
+		 * @param numTiles
+		 *   Number of tiles in the file.
+		 *
+		 * @param tileDimensions
+		 *   Size of each tile, in pixels.
+		 *
+		 * @param numPlanes
+		 *   Number of planes in each tile.
+		 *
+		 * @return Length of the file, in bytes, including padding.
+		 */
+		static stream::len fileSize(unsigned int numTiles, Point tileDimensions,
+			PlaneCount numPlanes);
+
 	protected:
 		Point tileDimensions;
 		PlaneCount numPlanes;
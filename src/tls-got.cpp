@@ -84,13 +84,15 @@ ColourDepth Image_GOT::colourDepth() const
 
 Point Image_GOT::dimensions() const
 {
-	this->content->seekg(0, stream::start);
-	uint16_t width, height;
-	*this->content
-		>> u16le(width)
-		>> u16le(height)
-	;
-	return {width * 4, height};
+	return this->hdrDims.get([this]() {
+		this->content->seekg(0, stream::start);
+		uint16_t width, height;
+		*this->content
+			>> u16le(width)
+			>> u16le(height)
+		;
+		return Point{width * 4, height};
+	});
 }
 
 void Image_GOT::dimensions(const Point& newDimensions)
@@ -105,6 +107,14 @@ void Image_GOT::dimensions(const Point& newDimensions)
 		<< u16le(width)
 		<< u16le(newDimensions.y)
 	;
+	this->hdrDims.set(newDimensions);
+	return;
+}
+
+void Image_GOT::dropCache()
+{
+	this->hdrDims.invalidate();
+	this->Image_VGA_Planar::dropCache();
 	return;
 }
 
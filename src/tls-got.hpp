@@ -23,6 +23,7 @@
 
 #include <camoto/gamegraphics/tilesettype.hpp>
 #include "img-vga-planar.hpp"
+#include "header-cache.hpp"
 
 namespace camoto {
 namespace gamegraphics {
@@ -69,6 +70,10 @@ class Image_GOT: virtual public Image_VGA_Planar
 		virtual ColourDepth colourDepth() const;
 		virtual Point dimensions() const;
 		virtual void dimensions(const Point& newDimensions);
+		virtual void dropCache();
+
+	protected:
+		mutable HeaderCache<Point> hdrDims; ///< Dimensions from the tile header
 };
 
 } // namespace gamearchive
@@ -479,6 +479,22 @@ void Image_Jill::convert(const Pixels& newContent, const Pixels& newMask)
 	return;
 }
 
+void Image_Jill::convert(Pixels&& newContent, Pixels&& newMask)
+{
+	this->pix = std::move(newContent);
+	this->mask = std::move(newMask);
+	this->fnChanged();
+	return;
+}
+
+void Image_Jill::convertInto(uint8_t *pixels, uint8_t *mask, size_t stride)
+	const
+{
+	if (pixels) this->copyRows(pixels, stride, this->dims, this->pix.data());
+	if (mask) this->copyRows(mask, stride, this->dims, this->mask.data());
+	return;
+}
+
 
 } // namespace gamegraphics
 } // namespace camoto
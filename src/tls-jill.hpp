@@ -118,10 +118,14 @@ class Image_Jill: virtual public Image
 		virtual ColourDepth colourDepth() const;
 		virtual Point dimensions() const;
 		virtual void dimensions(const Point& newDimensions);
+		using Image::convert;
 		virtual Pixels convert() const;
 		virtual Pixels convert_mask() const;
 		virtual void convert(const Pixels& newContent,
 			const Pixels& newMask);
+		virtual void convert(Pixels&& newContent, Pixels&& newMask);
+		virtual void convertInto(uint8_t *pixels, uint8_t *mask, size_t stride)
+			const;
 
 	protected:
 		Point dims;
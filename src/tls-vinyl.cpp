@@ -22,6 +22,7 @@
  */
 
 #include <cassert>
+#include <cstring> // memcpy
 #include <iostream>
 #include <camoto/iostream_helpers.hpp>
 #include <camoto/stream_filtered.hpp>
@@ -99,56 +100,49 @@ class Image_VGFM_MaskedTile: virtual public Image
 			return {VGFM_TILE_WIDTH, VGFM_TILE_HEIGHT};
 		}
 
-		virtual Pixels convert() const
+		using Image::convert;
+
+		virtual void convertInto(uint8_t *pixels, uint8_t *mask, size_t stride)
+			const
 		{
 			auto dims = this->dimensions();
 			unsigned long dataSize = dims.x * dims.y;
 
 			// Safety check to ensure supplied stream is long enough
-			auto streamSize = this->content->size();
-			if (streamSize < dataSize) {
-				throw stream::error(createString("An image of " << dims.x << "x" << dims.y
-						<< " requires " << dataSize << " bytes, but the supplied stream is only "
-						<< streamSize << " bytes long."));
-			}
-
-			Pixels pix;
-			pix.resize(dataSize);
-
-			this->content->seekg(0, stream::start);
-			auto pixbuf = pix.data();
-			for (unsigned int i = 0; i < dataSize; i += 4) {
-				// Skip over mask byte
-				this->content->seekg(1, stream::cur);
-				this->content->read(pixbuf, 4);
-				pixbuf += 4;
+			if (pixels) {
+				auto streamSize = this->content->size();
+				if (streamSize < dataSize) {
+					throw stream::error(createString("An image of " << dims.x << "x" << dims.y
+							<< " requires " << dataSize << " bytes, but the supplied stream is only "
+							<< streamSize << " bytes long."));
+				}
 			}
-			return pix;
-		}
-
-		virtual Pixels convert_mask() const
-		{
-			auto dims = this->dimensions();
-			unsigned int dataSize = dims.x * dims.y;
-
-			Pixels pix;
-			pix.resize(dataSize, 0);
 
 			this->content->seekg(0, stream::start);
-			for (unsigned int i = 0; i < dataSize; i += 4) {
-				uint8_t mask;
-				*this->content >> u8(mask);
-				for (int j = 0; j < 4; j++) {
-					// This algorithm only works with this enum value
-					static_assert((int)Image::Mask::Transparent == 1, "Algorithm must be updated");
-
-					pix[i + j] = (mask & 1) ^ 1;
-					mask >>= 1;
+			for (unsigned int y = 0; y < dims.y; y++) {
+				auto pixbuf = pixels ? pixels + y * stride : nullptr;
+				auto maskbuf = mask ? mask + y * stride : nullptr;
+				for (unsigned int x = 0; x < dims.x; x += 4) {
+					// Each group of four pixels is preceded by a byte with their mask bits
+					uint8_t group[5];
+					this->content->read(group, 5);
+					if (maskbuf) {
+						uint8_t maskbyte = group[0];
+						for (int j = 0; j < 4; j++) {
+							// This algorithm only works with this enum value
+							static_assert((int)Image::Mask::Transparent == 1, "Algorithm must be updated");
+
+							*maskbuf++ = (maskbyte & 1) ^ 1;
+							maskbyte >>= 1;
+						}
+					}
+					if (pixbuf) {
+						memcpy(pixbuf, &group[1], 4);
+						pixbuf += 4;
+					}
 				}
-				// Skip over pixels
-				this->content->seekg(4, stream::cur);
 			}
-			return pix;
+			return;
 		}
 
 		virtual void convert(const Pixels& newContent, const Pixels& newMask)
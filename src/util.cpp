@@ -18,57 +18,184 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
+#include <cstring>
 #include <camoto/util.hpp> // make_unique
 #include <camoto/gamegraphics/image-memory.hpp>
 #include <camoto/gamegraphics/util.hpp>
+#include "image-sub.hpp"
 
 namespace camoto {
 namespace gamegraphics {
 
-std::unique_ptr<Image> overlayImage(const Image* base, const Image* overlay)
+SpriteSpans compileSpans(const Image* img)
 {
-	auto pixBase = base->convert();
-	auto maskBase = base->convert_mask();
-	auto pixOverlay = overlay->convert();
-	auto maskOverlay = overlay->convert_mask();
-
-	auto len = pixBase.size();
-	Pixels pixMerged(len);
-	Pixels maskMerged(len);
-
-	auto pix_b = pixBase.data();
-	auto mask_b = maskBase.data();
-	auto pix_o = pixOverlay.data();
-	auto mask_o = maskOverlay.data();
-	auto pix_m = pixMerged.data();
-	auto mask_m = maskMerged.data();
-
-	for (unsigned int i = 0; i < len; i++) {
-		if (*mask_o & (int)Image::Mask::Transparent) {
-			// Overlay is transparent, use base pixel
-			*pix_m = *pix_b;
-			*mask_m = *mask_b;
-		} else {
-			// Overlay is nontransparent, use overlay pixel
-			*pix_m = *pix_o;
-			*mask_m = *mask_o;
+	SpriteSpans sprite;
+	sprite.dims = img->dimensions();
+	SharedPixels pixels, mask;
+	img->convertBothShared(pixels, mask);
+
+	// Without a mask every row is a single run, which is just the whole image
+	if (!img->hasMask()) {
+		for (long y = 0; y < sprite.dims.y; y++) {
+			sprite.spans.push_back(
+				{0, y, sprite.dims.x, (size_t)(y * sprite.dims.x)});
+		}
+		sprite.pixels = pixels.release();
+		sprite.mask = mask.release();
+		return sprite;
+	}
+
+	auto pix = pixels.data();
+	auto msk = mask.data();
+	for (long y = 0; y < sprite.dims.y; y++) {
+		auto rowPix = pix + y * sprite.dims.x;
+		auto rowMask = msk + y * sprite.dims.x;
+		long x = 0;
+		while (x < sprite.dims.x) {
+			// Skip over transparent pixels to the start of the next run
+			while ((x < sprite.dims.x)
+				&& (rowMask[x] & (uint8_t)Image::Mask::Transparent)) x++;
+			long start = x;
+			while ((x < sprite.dims.x)
+				&& !(rowMask[x] & (uint8_t)Image::Mask::Transparent)) x++;
+			if (x == start) break;
+
+			sprite.spans.push_back({start, y, x - start, sprite.pixels.size()});
+			sprite.pixels.insert(sprite.pixels.end(), rowPix + start, rowPix + x);
+			sprite.mask.insert(sprite.mask.end(), rowMask + start, rowMask + x);
 		}
-		pix_b++;
-		pix_o++;
-		pix_m++;
-		mask_b++;
-		mask_o++;
-		mask_m++;
 	}
+	return sprite;
+}
+
+void blitSpans(const SpriteSpans& sprite, const Point& pos, uint8_t *pixels,
+	uint8_t *mask, const Point& dims)
+{
+	for (auto& span : sprite.spans) {
+		long y = pos.y + span.y;
+		if ((y < 0) || (y >= dims.y)) continue;
+
+		// Clip the run to the left and right edges of the destination
+		long x = pos.x + span.x;
+		long skip = std::max(0L, -x);
+		long len = std::min(span.length, dims.x - x) - skip;
+		if (len <= 0) continue;
+
+		size_t dst = y * dims.x + x + skip;
+		size_t src = span.offset + skip;
+		memcpy(pixels + dst, &sprite.pixels[src], len);
+		if (mask) memcpy(mask + dst, &sprite.mask[src], len);
+	}
+	return;
+}
+
+std::unique_ptr<Image> overlayImage(const Image* base, const Image* overlay)
+{
+	// An overlay the same size as the base with no transparent pixels covers
+	// it completely, so its data can be shared as-is.
+	auto dims = base->dimensions();
+	if (
+		!(overlay->maskKind() & Image::MaskKind::Transparent)
+		&& (overlay->dimensions() == dims)
+	) {
+		SharedPixels pixOverlay, maskOverlay;
+		overlay->convertBothShared(pixOverlay, maskOverlay);
+		return std::make_unique<Image_Memory>(
+			dims,
+			pixOverlay,
+			maskOverlay,
+			Point{0, 0},
+			Point{0, 0},
+			nullptr
+		);
+	}
+
+	// Only the visible parts of the overlay are copied over the base image
+	Pixels pixMerged, maskMerged;
+	base->convertBoth(pixMerged, maskMerged);
+	auto sprite = compileSpans(overlay);
+	blitSpans(sprite, {0, 0}, pixMerged.data(), maskMerged.data(), dims);
+
 	return std::make_unique<Image_Memory>(
-		base->dimensions(),
-		pixMerged,
-		maskMerged,
+		dims,
+		std::move(pixMerged),
+		std::move(maskMerged),
 		Point{0, 0},
 		Point{0, 0},
 		nullptr
 	);
 }
 
+std::unique_ptr<Image> trimImage(Image* img)
+{
+	auto bounds = img->opaqueBounds();
+	auto stdImg = std::make_shared<Pixels>();
+	auto stdMask = std::make_shared<Pixels>();
+	img->convertBoth(*stdImg, *stdMask);
+
+	Point hotspot{0, 0};
+	if (img->caps() & Image::Caps::HasHotspot) hotspot = img->hotspot();
+	hotspot.x -= bounds.x;
+	hotspot.y -= bounds.y;
+
+	return std::make_unique<Image_Sub>(stdImg, stdMask, img->dimensions(),
+		bounds, img->colourDepth(), img->palette(), hotspot,
+		[img, stdImg, stdMask](){
+			img->convert(*stdImg, *stdMask);
+		}
+	);
+}
+
+/// Get 64 pixels from one row of a HitBitmap, starting at any position.
+/**
+ * @param row
+ *   Start of the row.
+ *
+ * @param stride
+ *   Number of words in the row.
+ *
+ * @param start
+ *   X coordinate of the first pixel to return, which ends up in the most
+ *   significant bit.  Pixels outside the row are returned as zero, so this
+ *   may be negative or past the end of the row.
+ */
+static uint64_t hitWindow(const uint64_t *row, long stride, long start)
+{
+	// Round towards negative infinity so pixels left of the row work too
+	long w = (start >= 0) ? start / 64 : -((63 - start) / 64);
+	unsigned int shift = start - w * 64;
+	uint64_t hi = ((w >= 0) && (w < stride)) ? row[w] : 0;
+	if (shift == 0) return hi;
+	uint64_t lo = ((w + 1 >= 0) && (w + 1 < stride)) ? row[w + 1] : 0;
+	return (hi << shift) | (lo >> (64 - shift));
+}
+
+bool hitTest(const HitBitmap& a, const Point& posA, const HitBitmap& b,
+	const Point& posB)
+{
+	// Find the rows where both sprites are present, relative to sprite A
+	long yStart = std::max(0L, posB.y - posA.y);
+	long yEnd = std::min(a.dims.y, posB.y + b.dims.y - posA.y);
+	long xStart = std::max(0L, posB.x - posA.x);
+	long xEnd = std::min(a.dims.x, posB.x + b.dims.x - posA.x);
+	if ((yStart >= yEnd) || (xStart >= xEnd)) return false;
+
+	// Only the words of A that overlap B need to be checked.  Any bits in them
+	// outside B come back as zero from hitWindow(), so they never match.
+	long wStart = xStart / 64;
+	long wEnd = (xEnd + 63) / 64;
+	long dx = posA.x - posB.x;
+	long dy = posA.y - posB.y;
+	for (long y = yStart; y < yEnd; y++) {
+		auto rowA = &a.bits[y * a.stride];
+		auto rowB = &b.bits[(y + dy) * b.stride];
+		for (long w = wStart; w < wEnd; w++) {
+			if (rowA[w] & hitWindow(rowB, b.stride, w * 64 + dx)) return true;
+		}
+	}
+	return false;
+}
+
 } // namespace gamegraphics
 } // namespace camoto
@@ -18,9 +18,12 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
 #include <iomanip>
 #include <functional>
 #include <camoto/util.hpp>
+#include <camoto/gamegraphics/image-memory.hpp>
+#include <camoto/gamegraphics/util.hpp>
 #include "test-image.hpp"
 
 using namespace camoto;
@@ -277,6 +280,118 @@ void test_image::sizedContent(const Point& dims, ImageType::Certainty result,
 		);
 	}
 
+	// Read pixels and mask into caller-supplied buffers
+	if ((dims.x > 0) && (dims.y > 0)) {
+		this->ts->add(
+			boost::unit_test::make_test_case(
+				std::bind(&test_image::test_sizedContent_read_into,
+					this, dims, result, content, strPixelsExpected),
+				createString("test_image[" << this->basename
+					<< "]::sizedContent_read_into[" << dims.x << "x" << dims.y << "]"),
+				__FILE__, __LINE__
+			)
+		);
+		this->ts->add(
+			boost::unit_test::make_test_case(
+				std::bind(&test_image::test_sizedContent_read_region,
+					this, dims, result, content, strPixelsExpected),
+				createString("test_image[" << this->basename
+					<< "]::sizedContent_read_region[" << dims.x << "x" << dims.y << "]"),
+				__FILE__, __LINE__
+			)
+		);
+		this->ts->add(
+			boost::unit_test::make_test_case(
+				std::bind(&test_image::test_sizedContent_overwrite,
+					this, dims, result, content),
+				createString("test_image[" << this->basename
+					<< "]::sizedContent_overwrite[" << dims.x << "x" << dims.y << "]"),
+				__FILE__, __LINE__
+			)
+		);
+		this->ts->add(
+			boost::unit_test::make_test_case(
+				std::bind(&test_image::test_sizedContent_shared,
+					this, dims, result, content),
+				createString("test_image[" << this->basename
+					<< "]::sizedContent_shared[" << dims.x << "x" << dims.y << "]"),
+				__FILE__, __LINE__
+			)
+		);
+		this->ts->add(
+			boost::unit_test::make_test_case(
+				std::bind(&test_image::test_sizedContent_mask_kind,
+					this, dims, result, content),
+				createString("test_image[" << this->basename
+					<< "]::sizedContent_mask_kind[" << dims.x << "x" << dims.y << "]"),
+				__FILE__, __LINE__
+			)
+		);
+		this->ts->add(
+			boost::unit_test::make_test_case(
+				std::bind(&test_image::test_sizedContent_hash,
+					this, dims, result, content),
+				createString("test_image[" << this->basename
+					<< "]::sizedContent_hash[" << dims.x << "x" << dims.y << "]"),
+				__FILE__, __LINE__
+			)
+		);
+		this->ts->add(
+			boost::unit_test::make_test_case(
+				std::bind(&test_image::test_sizedContent_uniform,
+					this, dims, result, content),
+				createString("test_image[" << this->basename
+					<< "]::sizedContent_uniform[" << dims.x << "x" << dims.y << "]"),
+				__FILE__, __LINE__
+			)
+		);
+		this->ts->add(
+			boost::unit_test::make_test_case(
+				std::bind(&test_image::test_sizedContent_hit,
+					this, dims, result, content),
+				createString("test_image[" << this->basename
+					<< "]::sizedContent_hit[" << dims.x << "x" << dims.y << "]"),
+				__FILE__, __LINE__
+			)
+		);
+		this->ts->add(
+			boost::unit_test::make_test_case(
+				std::bind(&test_image::test_sizedContent_bounds,
+					this, dims, result, content),
+				createString("test_image[" << this->basename
+					<< "]::sizedContent_bounds[" << dims.x << "x" << dims.y << "]"),
+				__FILE__, __LINE__
+			)
+		);
+		this->ts->add(
+			boost::unit_test::make_test_case(
+				std::bind(&test_image::test_sizedContent_spans,
+					this, dims, result, content),
+				createString("test_image[" << this->basename
+					<< "]::sizedContent_spans[" << dims.x << "x" << dims.y << "]"),
+				__FILE__, __LINE__
+			)
+		);
+		this->ts->add(
+			boost::unit_test::make_test_case(
+				std::bind(&test_image::test_sizedContent_write_region,
+					this, dims, result, content),
+				createString("test_image[" << this->basename
+					<< "]::sizedContent_write_region[" << dims.x << "x" << dims.y << "]"),
+				__FILE__, __LINE__
+			)
+		);
+		this->ts->add(
+			boost::unit_test::make_test_case(
+				std::bind(&test_image::test_sizedContent_transform,
+					this, dims, result, content),
+				createString("test_image[" << this->basename
+					<< "]::sizedContent_transform[" << dims.x << "x" << dims.y << "]"),
+				__FILE__, __LINE__
+			)
+		);
+	}
+
 	// Write pixels and mask
 	this->ts->add(
 		boost::unit_test::make_test_case(
@@ -408,6 +523,880 @@ void test_image::test_sizedContent_read_mask(const Point& dims,
 	return;
 }
 
+void test_image::test_sizedContent_read_into(const Point& dims,
+	ImageType::Certainty result, const std::string& content,
+	std::string strPixelsExpected)
+{
+	BOOST_TEST_MESSAGE(createString("sizedContent_read_into check ("
+		<< this->basename << "[" << dims.x << "x" << dims.y << "])"));
+
+	// Get the mask the normal way, to compare against
+	Pixels maskExpected;
+	{
+		auto ss = std::make_unique<stream::string>(content);
+		auto img = this->openImage(dims, std::move(ss), result, false);
+		maskExpected = img->convert_mask();
+	}
+	if (strPixelsExpected.empty()) {
+		auto pixelsExpected = createPixelData(dims, this->cga);
+		strPixelsExpected = std::string(pixelsExpected.begin(), pixelsExpected.end());
+	}
+
+	auto ss = std::make_unique<stream::string>(content);
+	auto img = this->openImage(dims, std::move(ss), result, false);
+
+	// Leave some padding after each row, which must not be touched
+	const uint8_t fill = 0xEE;
+	const unsigned int padding = 3;
+	size_t stride = dims.x + padding;
+	Pixels pixels(stride * dims.y, fill);
+	Pixels mask(stride * dims.y, fill);
+
+	BOOST_TEST_CHECKPOINT("Convert into padded buffers");
+	img->convertInto(pixels.data(), mask.data(), stride);
+
+	std::string strPixels, strMask;
+	for (unsigned int y = 0; y < dims.y; y++) {
+		auto row = pixels.begin() + y * stride;
+		auto rowMask = mask.begin() + y * stride;
+		strPixels.append(row, row + dims.x);
+		strMask.append(rowMask, rowMask + dims.x);
+		for (unsigned int x = dims.x; x < stride; x++) {
+			BOOST_REQUIRE_MESSAGE(
+				(pixels[y * stride + x] == fill) && (mask[y * stride + x] == fill),
+				"convertInto() wrote past the end of row " << y
+			);
+		}
+	}
+	BOOST_REQUIRE_MESSAGE(
+		this->is_equal(strPixelsExpected, strPixels),
+		"Converting into a padded buffer produced incorrect pixel data"
+	);
+	auto strMaskExpected = std::string(maskExpected.begin(), maskExpected.end());
+	BOOST_REQUIRE_MESSAGE(
+		this->is_equal(strMaskExpected, strMask),
+		"Converting into a padded buffer produced incorrect mask data"
+	);
+
+	BOOST_TEST_CHECKPOINT("Convert pixels and mask together");
+	{
+		auto ss = std::make_unique<stream::string>(content);
+		auto img = this->openImage(dims, std::move(ss), result, false);
+		Pixels pixelsBoth, maskBoth;
+		img->convertBoth(pixelsBoth, maskBoth);
+		BOOST_REQUIRE_MESSAGE(
+			this->is_equal(strPixelsExpected,
+				std::string(pixelsBoth.begin(), pixelsBoth.end())),
+			"convertBoth() produced incorrect pixel data"
+		);
+		BOOST_REQUIRE_MESSAGE(
+			this->is_equal(strMaskExpected,
+				std::string(maskBoth.begin(), maskBoth.end())),
+			"convertBoth() produced incorrect mask data"
+		);
+	}
+
+	BOOST_TEST_CHECKPOINT("Decode one row at a time");
+	{
+		auto ss = std::make_unique<stream::string>(content);
+		auto img = this->openImage(dims, std::move(ss), result, false);
+		std::string strPixelsRows, strMaskRows;
+		long nextRow = 0;
+		img->decodeRows([&](long y, const uint8_t *rowPixels,
+			const uint8_t *rowMask) {
+			BOOST_REQUIRE_EQUAL(y, nextRow);
+			nextRow++;
+			strPixelsRows.append((const char *)rowPixels, dims.x);
+			strMaskRows.append((const char *)rowMask, dims.x);
+		});
+		BOOST_REQUIRE_EQUAL(nextRow, dims.y);
+		BOOST_REQUIRE_MESSAGE(
+			this->is_equal(strPixelsExpected, strPixelsRows),
+			"decodeRows() produced incorrect pixel data"
+		);
+		BOOST_REQUIRE_MESSAGE(
+			this->is_equal(strMaskExpected, strMaskRows),
+			"decodeRows() produced incorrect mask data"
+		);
+	}
+
+	BOOST_TEST_CHECKPOINT("Convert to packed pixels");
+	{
+		auto ss = std::make_unique<stream::string>(content);
+		auto img = this->openImage(dims, std::move(ss), result, false);
+		unsigned int bpp = bitsPerPixel(img->colourDepth());
+		unsigned int lenRow = (dims.x * bpp + 7) / 8;
+		std::string strPackedExpected(lenRow * dims.y, '\x00');
+		for (unsigned int y = 0; y < dims.y; y++) {
+			for (unsigned int x = 0; x < dims.x; x++) {
+				unsigned int bit = x * bpp;
+				uint8_t pixel = strPixelsExpected[y * dims.x + x];
+				strPackedExpected[y * lenRow + bit / 8] |=
+					(pixel & ((1 << bpp) - 1)) << (8 - bpp - bit % 8);
+			}
+		}
+		auto packed = img->convertPacked();
+		BOOST_REQUIRE_MESSAGE(
+			this->is_equal(strPackedExpected,
+				std::string(packed.begin(), packed.end())),
+			"convertPacked() produced incorrect pixel data"
+		);
+	}
+
+	BOOST_TEST_CHECKPOINT("Convert mask to packed planes");
+	{
+		auto ss = std::make_unique<stream::string>(content);
+		auto img = this->openImage(dims, std::move(ss), result, false);
+		unsigned int lenRow = (dims.x + 7) / 8;
+		std::string strTransparentExpected(lenRow * dims.y, '\x00');
+		std::string strTouchExpected(lenRow * dims.y, '\x00');
+		for (unsigned int y = 0; y < dims.y; y++) {
+			for (unsigned int x = 0; x < dims.x; x++) {
+				uint8_t m = maskExpected[y * dims.x + x];
+				uint8_t cellBit = 0x80 >> (x % 8);
+				if (m & (uint8_t)Image::Mask::Transparent) {
+					strTransparentExpected[y * lenRow + x / 8] |= cellBit;
+				}
+				if (m & (uint8_t)Image::Mask::Touch) {
+					strTouchExpected[y * lenRow + x / 8] |= cellBit;
+				}
+			}
+		}
+		Pixels transparent, touch;
+		img->convertMaskPacked(transparent, touch);
+		BOOST_REQUIRE_MESSAGE(
+			this->is_equal(strTransparentExpected,
+				std::string(transparent.begin(), transparent.end())),
+			"convertMaskPacked() produced incorrect transparency data"
+		);
+		BOOST_REQUIRE_MESSAGE(
+			this->is_equal(strTouchExpected,
+				std::string(touch.begin(), touch.end())),
+			"convertMaskPacked() produced incorrect hitmap data"
+		);
+	}
+
+	BOOST_TEST_CHECKPOINT("Convert to RGBA");
+	{
+		auto ss = std::make_unique<stream::string>(content);
+		auto img = this->openImage(dims, std::move(ss), result, false);
+
+		// Use a palette with a different value in every channel
+		Palette pal(img->colourDepth() == ColourDepth::VGA ? 256 : 16);
+		for (unsigned int i = 0; i < pal.size(); i++) {
+			pal[i].red = i * 7;
+			pal[i].green = 255 - i;
+			pal[i].blue = i ^ 0x5A;
+			pal[i].alpha = 255 - (i % 3);
+		}
+		std::string strRGBAExpected;
+		for (unsigned int i = 0; i < dims.x * dims.y; i++) {
+			uint8_t pixel = strPixelsExpected[i];
+			if (
+				(maskExpected[i] & (uint8_t)Image::Mask::Transparent)
+				|| (pixel >= pal.size())
+			) {
+				strRGBAExpected.append(4, '\x00');
+			} else {
+				strRGBAExpected.push_back(pal[pixel].red);
+				strRGBAExpected.push_back(pal[pixel].green);
+				strRGBAExpected.push_back(pal[pixel].blue);
+				strRGBAExpected.push_back(pal[pixel].alpha);
+			}
+		}
+		auto rgba = img->convertRGBA(pal);
+		BOOST_REQUIRE_MESSAGE(
+			this->is_equal(strRGBAExpected, std::string(rgba.begin(), rgba.end())),
+			"convertRGBA() produced incorrect pixel data"
+		);
+	}
+
+	BOOST_TEST_CHECKPOINT("Take a snapshot");
+	{
+		auto ss = std::make_unique<stream::string>(content);
+		auto img = this->openImage(dims, std::move(ss), result, false);
+		auto snap = img->snapshot();
+		BOOST_REQUIRE_EQUAL(snap->dimensions.x, dims.x);
+		BOOST_REQUIRE_EQUAL(snap->dimensions.y, dims.y);
+		BOOST_CHECK_EQUAL(snap->hotspot.x, this->hotspot.x);
+		BOOST_CHECK_EQUAL(snap->hotspot.y, this->hotspot.y);
+		BOOST_CHECK_EQUAL(snap->hitrect.x, this->hitrect.x);
+		BOOST_CHECK_EQUAL(snap->hitrect.y, this->hitrect.y);
+		BOOST_REQUIRE_MESSAGE(
+			this->is_equal(strPixelsExpected,
+				std::string(snap->pixels.begin(), snap->pixels.end())),
+			"snapshot() produced incorrect pixel data"
+		);
+		BOOST_REQUIRE_MESSAGE(
+			this->is_equal(strMaskExpected,
+				std::string(snap->mask.begin(), snap->mask.end())),
+			"snapshot() produced incorrect mask data"
+		);
+
+		// The snapshot must remain usable once the image is gone
+		img.reset();
+		BOOST_REQUIRE_MESSAGE(
+			this->is_equal(strPixelsExpected,
+				std::string(snap->pixels.begin(), snap->pixels.end())),
+			"snapshot() data did not outlive the image"
+		);
+	}
+
+	return;
+}
+
+void test_image::test_sizedContent_read_region(const Point& dims,
+	ImageType::Certainty result, const std::string& content,
+	std::string strPixelsExpected)
+{
+	BOOST_TEST_MESSAGE(createString("sizedContent_read_region check ("
+		<< this->basename << "[" << dims.x << "x" << dims.y << "])"));
+
+	if (strPixelsExpected.empty()) {
+		auto pixelsExpected = createPixelData(dims, this->cga);
+		strPixelsExpected = std::string(pixelsExpected.begin(), pixelsExpected.end());
+	}
+
+	// Pick an area away from the edges where the image is large enough, so that
+	// both the start and end of each row and column are skipped.
+	Rect region{dims.x / 4, dims.y / 4, dims.x - dims.x / 2, dims.y - dims.y / 2};
+	std::string strRegionExpected;
+	for (long y = 0; y < region.height; y++) {
+		strRegionExpected.append(strPixelsExpected,
+			(region.y + y) * dims.x + region.x, region.width);
+	}
+
+	auto ss = std::make_unique<stream::string>(content);
+	auto img = this->openImage(dims, std::move(ss), result, false);
+
+	BOOST_TEST_CHECKPOINT("Convert region to standard pixel data");
+	auto pixels = img->convert(region);
+	BOOST_REQUIRE_MESSAGE(
+		this->is_equal(strRegionExpected, std::string(pixels.begin(), pixels.end())),
+		"Converting a region to standard pixel data produced incorrect result"
+	);
+
+	for (unsigned int shift = 1; shift <= 3; shift++) {
+		BOOST_TEST_CHECKPOINT("Convert preview at 1/" << (1 << shift) << " scale");
+		auto dimsPreview = img->previewDimensions(shift);
+		BOOST_CHECK_EQUAL(dimsPreview.x, (dims.x + (1 << shift) - 1) >> shift);
+		BOOST_CHECK_EQUAL(dimsPreview.y, (dims.y + (1 << shift) - 1) >> shift);
+		std::string strPreviewExpected;
+		for (long y = 0; y < dims.y; y += (1 << shift)) {
+			for (long x = 0; x < dims.x; x += (1 << shift)) {
+				strPreviewExpected += strPixelsExpected[y * dims.x + x];
+			}
+		}
+		auto preview = img->convertPreview(shift);
+		BOOST_REQUIRE_MESSAGE(
+			this->is_equal(strPreviewExpected,
+				std::string(preview.begin(), preview.end())),
+			"Converting a reduced size preview produced incorrect result"
+		);
+	}
+
+	BOOST_TEST_CHECKPOINT("Reject region outside image");
+	BOOST_CHECK_THROW(
+		img->convert(Rect{region.x + 1, 0, dims.x - region.x, 1}),
+		stream::error
+	);
+
+	return;
+}
+
+void test_image::test_sizedContent_overwrite(const Point& dims,
+	ImageType::Certainty result, const std::string& content)
+{
+	BOOST_TEST_MESSAGE(createString("sizedContent_overwrite check ("
+		<< this->basename << "[" << dims.x << "x" << dims.y << "])"));
+
+	auto ss = std::make_shared<stream::string>(content);
+	auto img = this->openImage(dims, stream_wrap(ss), result, false);
+
+	BOOST_TEST_CHECKPOINT("Decode original image");
+	Pixels pixOrig, maskOrig;
+	img->convertBoth(pixOrig, maskOrig);
+
+	BOOST_TEST_CHECKPOINT("Overwrite with a blank image");
+	Pixels pixBlank(dims.x * dims.y, 0x00);
+	img->convert(pixBlank, maskOrig);
+
+	// Any decoded copy kept from before the write must not be returned
+	BOOST_TEST_CHECKPOINT("Decode replaced image");
+	auto pixAfter = img->convert();
+	BOOST_REQUIRE_MESSAGE(
+		this->is_equal(std::string(pixBlank.begin(), pixBlank.end()),
+			std::string(pixAfter.begin(), pixAfter.end())),
+		"Image returned stale data after being overwritten"
+	);
+
+	BOOST_TEST_CHECKPOINT("Decode again without caching");
+	img->cacheDecoded(false);
+	pixAfter = img->convert();
+	BOOST_REQUIRE_MESSAGE(
+		this->is_equal(std::string(pixBlank.begin(), pixBlank.end()),
+			std::string(pixAfter.begin(), pixAfter.end())),
+		"Image returned incorrect data with caching disabled"
+	);
+	return;
+}
+
+void test_image::test_sizedContent_shared(const Point& dims,
+	ImageType::Certainty result, const std::string& content)
+{
+	BOOST_TEST_MESSAGE(createString("sizedContent_shared check ("
+		<< this->basename << "[" << dims.x << "x" << dims.y << "])"));
+
+	auto ss = std::make_shared<stream::string>(content);
+	auto img = this->openImage(dims, stream_wrap(ss), result, false);
+
+	BOOST_TEST_CHECKPOINT("Decode original image");
+	Pixels pixOrig, maskOrig;
+	img->convertBoth(pixOrig, maskOrig);
+
+	BOOST_TEST_CHECKPOINT("Decode original image without copying");
+	SharedPixels sharedPix, sharedMask;
+	img->convertBothShared(sharedPix, sharedMask);
+	BOOST_REQUIRE_MESSAGE((*sharedPix == pixOrig) && (*sharedMask == maskOrig),
+		"Shared conversion returned different data to convertBoth()");
+	BOOST_REQUIRE_MESSAGE(*img->convertShared() == pixOrig,
+		"Shared conversion returned different data to convert()");
+
+	BOOST_TEST_CHECKPOINT("Overwrite with a blank image");
+	Pixels pixBlank(dims.x * dims.y, 0x00);
+	img->convert(pixBlank, maskOrig);
+
+	// Buffers handed out earlier must keep the data they had at the time
+	BOOST_REQUIRE_MESSAGE((*sharedPix == pixOrig) && (*sharedMask == maskOrig),
+		"Shared buffer was modified when the image was overwritten");
+	auto sharedAfter = img->convertShared();
+	BOOST_REQUIRE_MESSAGE(*sharedAfter == pixBlank,
+		"Shared conversion returned stale data after being overwritten");
+	return;
+}
+
+void test_image::test_sizedContent_mask_kind(const Point& dims,
+	ImageType::Certainty result, const std::string& content)
+{
+	BOOST_TEST_MESSAGE(createString("sizedContent_mask_kind check ("
+		<< this->basename << "[" << dims.x << "x" << dims.y << "])"));
+
+	auto ss = std::make_unique<stream::string>(content);
+	auto img = this->openImage(dims, std::move(ss), result, false);
+
+	BOOST_TEST_CHECKPOINT("Decode original image");
+	Pixels pixOrig, maskOrig;
+	img->convertBoth(pixOrig, maskOrig);
+
+	BOOST_TEST_CHECKPOINT("Check mask kind");
+	uint8_t maskBits = 0;
+	for (auto m : maskOrig) maskBits |= m;
+	BOOST_REQUIRE_MESSAGE((maskBits & ~(uint8_t)img->maskKind()) == 0,
+		"Mask contains bits that maskKind() says the format can't store");
+	BOOST_REQUIRE_MESSAGE(*img->convertMaskShared() == maskOrig,
+		"Shared mask conversion returned different data to convertBoth()");
+	return;
+}
+
+void test_image::test_sizedContent_hash(const Point& dims,
+	ImageType::Certainty result, const std::string& content)
+{
+	BOOST_TEST_MESSAGE(createString("sizedContent_hash check ("
+		<< this->basename << "[" << dims.x << "x" << dims.y << "])"));
+
+	auto ss = std::make_shared<stream::string>(content);
+	auto img = this->openImage(dims, stream_wrap(ss), result, false);
+
+	BOOST_TEST_CHECKPOINT("Decode original image");
+	Pixels pixOrig, maskOrig;
+	img->convertBoth(pixOrig, maskOrig);
+
+	BOOST_TEST_CHECKPOINT("Hash original image");
+	auto hashOrig = img->contentHash();
+	BOOST_REQUIRE_MESSAGE(img->contentHash() == hashOrig,
+		"Content hash changed without the image being modified");
+
+	BOOST_TEST_CHECKPOINT("Overwrite with a blank image");
+	Pixels pixBlank(dims.x * dims.y, 0x00);
+	img->convert(pixBlank, maskOrig);
+
+	if (pixBlank != pixOrig) {
+		BOOST_REQUIRE_MESSAGE(img->contentHash() != hashOrig,
+			"Content hash did not change after the image was overwritten");
+	}
+	return;
+}
+
+void test_image::test_sizedContent_uniform(const Point& dims,
+	ImageType::Certainty result, const std::string& content)
+{
+	BOOST_TEST_MESSAGE(createString("sizedContent_uniform check ("
+		<< this->basename << "[" << dims.x << "x" << dims.y << "])"));
+
+	auto ss = std::make_shared<stream::string>(content);
+	auto img = this->openImage(dims, stream_wrap(ss), result, false);
+
+	BOOST_TEST_CHECKPOINT("Decode original image");
+	Pixels pixOrig, maskOrig;
+	img->convertBoth(pixOrig, maskOrig);
+
+	auto allSame = [](const Pixels& data) {
+		return std::all_of(data.begin(), data.end(),
+			[&data](uint8_t b) { return b == data[0]; });
+	};
+
+	BOOST_TEST_CHECKPOINT("Check whether original image is uniform");
+	uint8_t colour = 0xFF, maskValue = 0xFF;
+	bool uniform = img->isUniform(&colour, &maskValue);
+	BOOST_REQUIRE_EQUAL(uniform, allSame(pixOrig) && allSame(maskOrig));
+	if (uniform) {
+		BOOST_REQUIRE_EQUAL((int)colour, (int)pixOrig[0]);
+		BOOST_REQUIRE_EQUAL((int)maskValue, (int)maskOrig[0]);
+	}
+
+	BOOST_TEST_CHECKPOINT("Overwrite with a blank image");
+	Pixels pixBlank(dims.x * dims.y, 0x00);
+	img->convert(pixBlank, maskOrig);
+
+	BOOST_TEST_CHECKPOINT("Check whether blank image is uniform");
+	uniform = img->isUniform(&colour, &maskValue);
+	BOOST_REQUIRE_EQUAL(uniform, allSame(maskOrig));
+	if (uniform) {
+		BOOST_REQUIRE_EQUAL((int)colour, 0);
+		BOOST_REQUIRE_EQUAL((int)maskValue, (int)maskOrig[0]);
+	}
+	return;
+}
+
+void test_image::test_sizedContent_hit(const Point& dims,
+	ImageType::Certainty result, const std::string& content)
+{
+	BOOST_TEST_MESSAGE(createString("sizedContent_hit check ("
+		<< this->basename << "[" << dims.x << "x" << dims.y << "])"));
+
+	auto ss = std::make_unique<stream::string>(content);
+	auto img = this->openImage(dims, std::move(ss), result, false);
+
+	BOOST_TEST_CHECKPOINT("Decode original image");
+	Pixels pixOrig, maskOrig;
+	img->convertBoth(pixOrig, maskOrig);
+
+	BOOST_TEST_CHECKPOINT("Check collision bitmap");
+	auto hit = img->hitBitmap();
+	BOOST_REQUIRE(hit.dims == dims);
+	BOOST_REQUIRE_EQUAL(hit.stride, (size_t)(dims.x + 63) / 64);
+	bool useTouch = img->maskKind() & Image::MaskKind::Touch;
+	bool anySolid = false;
+	for (long y = 0; y < dims.y; y++) {
+		for (long x = 0; x < dims.x; x++) {
+			uint8_t m = maskOrig[y * dims.x + x];
+			bool solid = useTouch
+				? (m & (uint8_t)Image::Mask::Touch)
+				: !(m & (uint8_t)Image::Mask::Transparent);
+			BOOST_REQUIRE_MESSAGE(hit.test(x, y) == solid, createString(
+				"hitBitmap() has the wrong value for pixel (" << x << "," << y
+				<< ")"));
+			anySolid |= solid;
+		}
+		if (dims.x % 64) {
+			BOOST_REQUIRE_MESSAGE(
+				(hit.bits[(y + 1) * hit.stride - 1] << (dims.x % 64)) == 0,
+				"hitBitmap() has bits set past the end of a row");
+		}
+	}
+
+	BOOST_TEST_CHECKPOINT("Check collision between sprites");
+	BOOST_REQUIRE_EQUAL(hitTest(hit, {0, 0}, hit, {0, 0}), anySolid);
+	BOOST_REQUIRE(!hitTest(hit, {0, 0}, hit, {dims.x, 0}));
+	BOOST_REQUIRE(!hitTest(hit, {0, 0}, hit, {0, -dims.y}));
+	// Compare against a pixel-by-pixel check for a few offsets
+	for (long off = 1; off < std::min(dims.x, 70L); off += 3) {
+		Point pos{(off % 2) ? -off : off, off % 3 - 1};
+		bool expected = false;
+		for (long y = 0; y < dims.y; y++) {
+			long yb = y - pos.y;
+			if ((yb < 0) || (yb >= dims.y)) continue;
+			for (long x = 0; x < dims.x; x++) {
+				long xb = x - pos.x;
+				if ((xb < 0) || (xb >= dims.x)) continue;
+				if (hit.test(x, y) && hit.test(xb, yb)) expected = true;
+			}
+		}
+		BOOST_REQUIRE_MESSAGE(hitTest(hit, {0, 0}, hit, pos) == expected,
+			createString("hitTest() gave the wrong result for an offset of ("
+				<< pos.x << "," << pos.y << ")"));
+		BOOST_REQUIRE_EQUAL(hitTest(hit, pos, hit, {0, 0}), expected);
+	}
+
+	BOOST_TEST_CHECKPOINT("Check collision bitmap of image without hitmap");
+	{
+		// Image_Memory reports only the mask bits it holds, so with no hitmap
+		// data the opaque pixels must be used instead.
+		Pixels maskTransparent(maskOrig);
+		bool anyOpaque = false, anyTransparent = false;
+		for (auto& m : maskTransparent) {
+			m &= (uint8_t)Image::Mask::Transparent;
+			if (m) anyTransparent = true;
+			else anyOpaque = true;
+		}
+		Image_Memory sprite(dims, pixOrig, maskTransparent, {0, 0}, {0, 0},
+			nullptr);
+		BOOST_REQUIRE(!(sprite.maskKind() & Image::MaskKind::Touch));
+		BOOST_REQUIRE(sprite.maskKind() == (anyTransparent
+			? Image::MaskKind::Transparent : Image::MaskKind::Opaque));
+		auto hitSprite = sprite.hitBitmap();
+		for (long y = 0; y < dims.y; y++) {
+			for (long x = 0; x < dims.x; x++) {
+				BOOST_REQUIRE_MESSAGE(
+					hitSprite.test(x, y) == !maskTransparent[y * dims.x + x],
+					createString("hitBitmap() without a hitmap has the wrong value for "
+						"pixel (" << x << "," << y << ")"));
+			}
+		}
+		BOOST_REQUIRE_EQUAL(hitTest(hitSprite, {0, 0}, hitSprite, {0, 0}),
+			anyOpaque);
+	}
+	return;
+}
+
+void test_image::test_sizedContent_bounds(const Point& dims,
+	ImageType::Certainty result, const std::string& content)
+{
+	BOOST_TEST_MESSAGE(createString("sizedContent_bounds check ("
+		<< this->basename << "[" << dims.x << "x" << dims.y << "])"));
+
+	auto ss = std::make_unique<stream::string>(content);
+	auto img = this->openImage(dims, std::move(ss), result, false);
+
+	BOOST_TEST_CHECKPOINT("Decode original image");
+	Pixels pixOrig, maskOrig;
+	img->convertBoth(pixOrig, maskOrig);
+
+	BOOST_TEST_CHECKPOINT("Check opaque bounds");
+	{
+		long left = dims.x, top = dims.y, right = 0, bottom = 0;
+		for (long y = 0; y < dims.y; y++) {
+			for (long x = 0; x < dims.x; x++) {
+				if (maskOrig[y * dims.x + x] & (uint8_t)Image::Mask::Transparent) {
+					continue;
+				}
+				left = std::min(left, x);
+				top = std::min(top, y);
+				right = std::max(right, x + 1);
+				bottom = std::max(bottom, y + 1);
+			}
+		}
+		auto bounds = img->opaqueBounds();
+		if (right == 0) {
+			BOOST_REQUIRE_EQUAL(bounds.width, 0);
+			BOOST_REQUIRE_EQUAL(bounds.height, 0);
+		} else {
+			BOOST_REQUIRE_EQUAL(bounds.x, left);
+			BOOST_REQUIRE_EQUAL(bounds.y, top);
+			BOOST_REQUIRE_EQUAL(bounds.width, right - left);
+			BOOST_REQUIRE_EQUAL(bounds.height, bottom - top);
+		}
+
+		// Wide enough that whole words, single bytes and the padded last byte of
+		// each row are all used
+		Point dimsWide{203, 3};
+		Pixels maskWide(dimsWide.x * dimsWide.y,
+			(uint8_t)Image::Mask::Transparent);
+		maskWide[1 * dimsWide.x + 70] = 0;
+		maskWide[2 * dimsWide.x + 130] = 0;
+		maskWide[1 * dimsWide.x + 195] = 0;
+		Image_Memory wide(dimsWide, Pixels(maskWide.size(), 0), maskWide,
+			{0, 0}, {0, 0}, nullptr);
+		auto boundsWide = wide.opaqueBounds();
+		BOOST_REQUIRE_EQUAL(boundsWide.x, 70);
+		BOOST_REQUIRE_EQUAL(boundsWide.y, 1);
+		BOOST_REQUIRE_EQUAL(boundsWide.width, 196 - 70);
+		BOOST_REQUIRE_EQUAL(boundsWide.height, 2);
+	}
+
+	BOOST_TEST_CHECKPOINT("Trim transparent border");
+	if ((dims.x > 2) && (dims.y > 2)) {
+		// Make everything transparent except the pixels inside a one pixel border
+		Pixels maskBorder(maskOrig.size(), (uint8_t)Image::Mask::Transparent);
+		for (long y = 1; y < dims.y - 1; y++) {
+			for (long x = 1; x < dims.x - 1; x++) maskBorder[y * dims.x + x] = 0;
+		}
+		Image_Memory border(dims, pixOrig, maskBorder, {0, 0}, {0, 0}, nullptr);
+		auto bounds = border.opaqueBounds();
+		BOOST_REQUIRE_EQUAL(bounds.x, 1);
+		BOOST_REQUIRE_EQUAL(bounds.y, 1);
+		BOOST_REQUIRE_EQUAL(bounds.width, dims.x - 2);
+		BOOST_REQUIRE_EQUAL(bounds.height, dims.y - 2);
+
+		auto trimmed = trimImage(&border);
+		BOOST_REQUIRE(trimmed->dimensions() == (Point{dims.x - 2, dims.y - 2}));
+		BOOST_REQUIRE(trimmed->caps() & Image::Caps::HasHotspot);
+		BOOST_REQUIRE(trimmed->hotspot() == (Point{-1, -1}));
+		auto pixTrimmed = trimmed->convert();
+		auto maskTrimmed = trimmed->convert_mask();
+		for (long y = 0; y < dims.y - 2; y++) {
+			for (long x = 0; x < dims.x - 2; x++) {
+				auto i = y * (dims.x - 2) + x;
+				BOOST_REQUIRE_EQUAL((int)pixTrimmed[i],
+					(int)pixOrig[(y + 1) * dims.x + x + 1]);
+				BOOST_REQUIRE_EQUAL((int)maskTrimmed[i], 0);
+			}
+		}
+
+		// Changes to the trimmed image must end up in the original
+		for (auto& p : pixTrimmed) p ^= 0x0F;
+		trimmed->convert(pixTrimmed, maskTrimmed);
+		auto pixBorder = border.convert();
+		for (long y = 0; y < dims.y; y++) {
+			for (long x = 0; x < dims.x; x++) {
+				bool inside = (x > 0) && (y > 0) && (x < dims.x - 1)
+					&& (y < dims.y - 1);
+				auto i = y * dims.x + x;
+				BOOST_REQUIRE_EQUAL((int)pixBorder[i],
+					(int)(inside ? (pixOrig[i] ^ 0x0F) : pixOrig[i]));
+			}
+		}
+	}
+	return;
+}
+
+void test_image::test_sizedContent_spans(const Point& dims,
+	ImageType::Certainty result, const std::string& content)
+{
+	BOOST_TEST_MESSAGE(createString("sizedContent_spans check ("
+		<< this->basename << "[" << dims.x << "x" << dims.y << "])"));
+
+	auto ss = std::make_unique<stream::string>(content);
+	auto img = this->openImage(dims, std::move(ss), result, false);
+
+	BOOST_TEST_CHECKPOINT("Decode original image");
+	Pixels pixOrig, maskOrig;
+	img->convertBoth(pixOrig, maskOrig);
+
+	BOOST_TEST_CHECKPOINT("Draw image as compiled spans");
+	{
+		auto sprite = compileSpans(img.get());
+		BOOST_REQUIRE(sprite.dims == dims);
+		// Draw it at an offset so clipping on every edge is tested
+		for (long off : {0L, 1L, -1L, 9L}) {
+			Point pos{off, -off};
+			Pixels pixDest(pixOrig.size(), 0xFF);
+			Pixels maskDest(maskOrig.size(), 0xFF);
+			blitSpans(sprite, pos, pixDest.data(), maskDest.data(), dims);
+			for (long y = 0; y < dims.y; y++) {
+				for (long x = 0; x < dims.x; x++) {
+					long xs = x - pos.x, ys = y - pos.y;
+					uint8_t pixExpected = 0xFF, maskExpected = 0xFF;
+					if ((xs >= 0) && (xs < dims.x) && (ys >= 0) && (ys < dims.y)) {
+						auto i = ys * dims.x + xs;
+						if (!(maskOrig[i] & (uint8_t)Image::Mask::Transparent)) {
+							pixExpected = pixOrig[i];
+							maskExpected = maskOrig[i];
+						}
+					}
+					BOOST_REQUIRE_MESSAGE(
+						(pixDest[y * dims.x + x] == pixExpected)
+						&& (maskDest[y * dims.x + x] == maskExpected),
+						createString("blitSpans() drew the wrong value at (" << x << ","
+							<< y << ") with the sprite at (" << pos.x << "," << pos.y
+							<< ")"));
+				}
+			}
+		}
+	}
+
+	BOOST_TEST_CHECKPOINT("Overlay image onto itself");
+	{
+		auto merged = overlayImage(img.get(), img.get());
+		Pixels pixMerged, maskMerged;
+		merged->convertBoth(pixMerged, maskMerged);
+		BOOST_REQUIRE_MESSAGE((pixMerged == pixOrig) && (maskMerged == maskOrig),
+			"overlayImage() changed an image overlaid with itself");
+
+		// Opaque overlays keep their hitmap, and only cover the base image
+		// where they overlap it
+		for (long shrink : {0L, 1L}) {
+			Point dimsOver{std::max(dims.x - shrink, 1L),
+				std::max(dims.y - shrink, 1L)};
+			Pixels pixOver(dimsOver.x * dimsOver.y, 0x0F);
+			Pixels maskOver(pixOver.size(), (uint8_t)Image::Mask::Touch);
+			Image_Memory over(dimsOver, pixOver, maskOver, {0, 0}, {0, 0},
+				nullptr);
+			merged = overlayImage(img.get(), &over);
+			merged->convertBoth(pixMerged, maskMerged);
+			for (long y = 0; y < dims.y; y++) {
+				for (long x = 0; x < dims.x; x++) {
+					auto i = y * dims.x + x;
+					bool covered = (x < dimsOver.x) && (y < dimsOver.y);
+					BOOST_REQUIRE_EQUAL((int)pixMerged[i],
+						(int)(covered ? 0x0F : pixOrig[i]));
+					BOOST_REQUIRE_EQUAL((int)maskMerged[i],
+						(int)(covered ? (uint8_t)Image::Mask::Touch : maskOrig[i]));
+				}
+			}
+		}
+	}
+	return;
+}
+
+void test_image::test_sizedContent_write_region(const Point& dims,
+	ImageType::Certainty result, const std::string& content)
+{
+	BOOST_TEST_MESSAGE(createString("sizedContent_write_region check ("
+		<< this->basename << "[" << dims.x << "x" << dims.y << "])"));
+
+	auto ss = std::make_shared<stream::string>(content);
+	auto img = this->openImage(dims, stream_wrap(ss), result, false);
+
+	BOOST_TEST_CHECKPOINT("Decode original image");
+	Pixels pixOrig, maskOrig;
+	img->convertBoth(pixOrig, maskOrig);
+
+	// Use an area that doesn't start or end on a byte boundary where the image
+	// is large enough, and invert every pixel in it so they all change.
+	Rect region{dims.x / 3, dims.y / 3, dims.x - dims.x / 3 - dims.x / 4,
+		dims.y - dims.y / 3 - dims.y / 4};
+	uint8_t colourMask = (1 << bitsPerPixel(img->colourDepth())) - 1;
+	Pixels pixRegion, maskRegion;
+	auto pixExp = pixOrig;
+	for (long y = 0; y < region.height; y++) {
+		for (long x = 0; x < region.width; x++) {
+			auto off = (region.y + y) * dims.x + region.x + x;
+			pixExp[off] = ~pixOrig[off] & colourMask;
+			pixRegion.push_back(pixExp[off]);
+			maskRegion.push_back(maskOrig[off]);
+		}
+	}
+
+	BOOST_TEST_CHECKPOINT("Replace region");
+	img->convert(region, pixRegion, maskRegion);
+
+	BOOST_TEST_CHECKPOINT("Decode modified image");
+	Pixels pixAfter, maskAfter;
+	img->convertBoth(pixAfter, maskAfter);
+	BOOST_REQUIRE_MESSAGE(
+		this->is_equal(std::string(pixExp.begin(), pixExp.end()),
+			std::string(pixAfter.begin(), pixAfter.end())),
+		"Replacing a region produced incorrect result"
+	);
+	BOOST_REQUIRE_MESSAGE(
+		this->is_equal(std::string(maskOrig.begin(), maskOrig.end()),
+			std::string(maskAfter.begin(), maskAfter.end())),
+		"Replacing a region changed the mask"
+	);
+
+	BOOST_TEST_CHECKPOINT("Decode modified image again from a new instance");
+	auto img2 = this->openImage(dims, stream_wrap(ss), result, false);
+	pixAfter = img2->convert();
+	BOOST_REQUIRE_MESSAGE(
+		this->is_equal(std::string(pixExp.begin(), pixExp.end()),
+			std::string(pixAfter.begin(), pixAfter.end())),
+		"Replaced region was not written back to the underlying stream"
+	);
+	return;
+}
+
+void test_image::test_sizedContent_transform(const Point& dims,
+	ImageType::Certainty result, const std::string& content)
+{
+	BOOST_TEST_MESSAGE(createString("sizedContent_transform check ("
+		<< this->basename << "[" << dims.x << "x" << dims.y << "])"));
+
+	auto ss = std::make_shared<stream::string>(content);
+	auto img = this->openImage(dims, stream_wrap(ss), result, false);
+
+	BOOST_TEST_CHECKPOINT("Decode original image");
+	Pixels pixOrig, maskOrig;
+	img->convertBoth(pixOrig, maskOrig);
+
+	// Rearrange the original image, with pixel (x, y) in the result coming from
+	// fnSource(x, y) in the original.
+	auto transform = [&pixOrig, &maskOrig, &dims](const Point& dimsNew,
+		Pixels& pixels, Pixels& mask, std::function<long(long, long)> fnSource)
+	{
+		pixels.resize(dimsNew.x * dimsNew.y);
+		mask.resize(dimsNew.x * dimsNew.y);
+		for (long y = 0; y < dimsNew.y; y++) {
+			for (long x = 0; x < dimsNew.x; x++) {
+				pixels[y * dimsNew.x + x] = pixOrig[fnSource(x, y)];
+				mask[y * dimsNew.x + x] = maskOrig[fnSource(x, y)];
+			}
+		}
+	};
+	auto check = [this, &img](const Pixels& pixExp, const Pixels& maskExp,
+		const char *msg)
+	{
+		Pixels pixels, mask;
+		img->convertBoth(pixels, mask);
+		BOOST_REQUIRE_MESSAGE(
+			this->is_equal(std::string(pixExp.begin(), pixExp.end()),
+				std::string(pixels.begin(), pixels.end())),
+			msg
+		);
+		BOOST_REQUIRE_MESSAGE(
+			this->is_equal(std::string(maskExp.begin(), maskExp.end()),
+				std::string(mask.begin(), mask.end())),
+			createString(msg << " (mask)")
+		);
+	};
+	Pixels pixExp, maskExp;
+
+	BOOST_TEST_CHECKPOINT("Flip horizontally");
+	img->flipH();
+	transform(dims, pixExp, maskExp, [&dims](long x, long y) {
+		return y * dims.x + (dims.x - 1 - x);
+	});
+	check(pixExp, maskExp, "Horizontal flip produced incorrect result");
+
+	BOOST_TEST_CHECKPOINT("Flip vertically");
+	img->flipV();
+	transform(dims, pixExp, maskExp, [&dims](long x, long y) {
+		return (dims.y - 1 - y) * dims.x + (dims.x - 1 - x);
+	});
+	check(pixExp, maskExp, "Vertical flip produced incorrect result");
+
+	BOOST_TEST_CHECKPOINT("Flip back again");
+	img->flipH();
+	img->flipV();
+	check(pixOrig, maskOrig, "Flipping twice did not restore the image");
+
+	bool canResize = img->caps() & Image::Caps::SetDimensions;
+	if ((dims.x == dims.y) || canResize) {
+		BOOST_TEST_CHECKPOINT("Rotate");
+		img->rotate90();
+		auto dimsRotated = img->dimensions();
+		BOOST_CHECK_EQUAL(dimsRotated.x, dims.y);
+		BOOST_CHECK_EQUAL(dimsRotated.y, dims.x);
+		transform(Point{dims.y, dims.x}, pixExp, maskExp, [&dims](long x, long y) {
+			return (dims.y - 1 - x) * dims.x + y;
+		});
+		check(pixExp, maskExp, "Rotation produced incorrect result");
+
+		BOOST_TEST_CHECKPOINT("Rotate back to the start");
+		img->rotate90();
+		img->rotate90();
+		img->rotate90();
+		check(pixOrig, maskOrig, "Rotating four times did not restore the image");
+	} else {
+		BOOST_CHECK_THROW(img->rotate90(), stream::error);
+	}
+
+	if (canResize && (dims.x > 2) && (dims.y > 2)) {
+		BOOST_TEST_CHECKPOINT("Crop");
+		Rect region{1, 1, dims.x - 2, dims.y - 2};
+		img->crop(region);
+		auto dimsCropped = img->dimensions();
+		BOOST_CHECK_EQUAL(dimsCropped.x, region.width);
+		BOOST_CHECK_EQUAL(dimsCropped.y, region.height);
+		transform(Point{region.width, region.height}, pixExp, maskExp,
+			[&dims](long x, long y) {
+				return (y + 1) * dims.x + (x + 1);
+			});
+		check(pixExp, maskExp, "Cropping produced incorrect result");
+	}
+	return;
+}
+
 void test_image::test_sizedContent_create(const Point& dims,
 	ImageType::Certainty result, const std::string& content,
 	std::shared_ptr<const Palette> palette, std::string strPixelsExpected)
@@ -474,6 +1463,20 @@ void test_image::test_sizedContent_create(const Point& dims,
 			"Image data supplied to this test is the wrong length (got "
 			<< pix.size() << " bytes, need " << imageSize << " bytes)");
 	}
+
+	BOOST_TEST_CHECKPOINT("Calculate encoded size");
+	std::string dataBefore = ss->data;
+	bool knowSize = true;
+	stream::len lenEncoded = 0;
+	try {
+		lenEncoded = img->encodedSize(pix, maskData);
+	} catch (const stream::error&) {
+		// This format can't calculate the size
+		knowSize = false;
+	}
+	BOOST_CHECK_MESSAGE(ss->data == dataBefore,
+		"Calculating the encoded size wrote to the underlying stream");
+
 	img->convert(pix, maskData);
 
 	BOOST_TEST_CHECKPOINT("Compare result of conversion");
@@ -481,6 +1484,9 @@ void test_image::test_sizedContent_create(const Point& dims,
 		this->is_equal(content, ss->data),
 		"Converting to native format produced incorrect result"
 	);
+	if (knowSize) {
+		BOOST_CHECK_EQUAL(lenEncoded, ss->data.size());
+	}
 	return;
 }
 
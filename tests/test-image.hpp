@@ -149,6 +149,56 @@ class test_image: public test_main
 		void test_sizedContent_read_mask(const Point& dims,
 			ImageType::Certainty result, const std::string& content);
 
+		/// Perform a sizedContent check now, reading into a padded buffer.
+		void test_sizedContent_read_into(const Point& dims,
+			ImageType::Certainty result, const std::string& content,
+			std::string strPixelsExpected);
+
+		/// Perform a sizedContent check now, reading only part of the image.
+		void test_sizedContent_read_region(const Point& dims,
+			ImageType::Certainty result, const std::string& content,
+			std::string strPixelsExpected);
+
+		/// Perform a sizedContent check now, reading back after a write.
+		void test_sizedContent_overwrite(const Point& dims,
+			ImageType::Certainty result, const std::string& content);
+
+		/// Perform a sizedContent check now, sharing buffers without copying.
+		void test_sizedContent_shared(const Point& dims,
+			ImageType::Certainty result, const std::string& content);
+
+		/// Perform a sizedContent check now, checking maskKind().
+		void test_sizedContent_mask_kind(const Point& dims,
+			ImageType::Certainty result, const std::string& content);
+
+		/// Perform a sizedContent check now, hashing before and after a write.
+		void test_sizedContent_hash(const Point& dims,
+			ImageType::Certainty result, const std::string& content);
+
+		/// Perform a sizedContent check now, looking for single-colour images.
+		void test_sizedContent_uniform(const Point& dims,
+			ImageType::Certainty result, const std::string& content);
+
+		/// Perform a sizedContent check now, building collision bitmaps.
+		void test_sizedContent_hit(const Point& dims,
+			ImageType::Certainty result, const std::string& content);
+
+		/// Perform a sizedContent check now, trimming the opaque area.
+		void test_sizedContent_bounds(const Point& dims,
+			ImageType::Certainty result, const std::string& content);
+
+		/// Perform a sizedContent check now, drawing span-list sprites.
+		void test_sizedContent_spans(const Point& dims,
+			ImageType::Certainty result, const std::string& content);
+
+		/// Perform a sizedContent check now, replacing part of the image.
+		void test_sizedContent_write_region(const Point& dims,
+			ImageType::Certainty result, const std::string& content);
+
+		/// Perform a sizedContent check now, flipping and rotating the image.
+		void test_sizedContent_transform(const Point& dims,
+			ImageType::Certainty result, const std::string& content);
+
 		/// Perform a sizedContent check now, creating a new image.
 		void test_sizedContent_create(const Point& dims,
 			ImageType::Certainty result, const std::string& content,
@@ -0,0 +1,190 @@
+/**
+ * @file   test-pixel-arena.cpp
+ * @brief  Test code for custom allocation of pixel buffers.
+ *
+ * Copyright (C) 2010-2017 Adam Nielsen <malvineous@shikadi.net>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstring>
+#include <boost/test/unit_test.hpp>
+
+#include <camoto/gamegraphics/image.hpp>
+#include <camoto/gamegraphics/image-memory.hpp>
+#include <camoto/gamegraphics/pixel-arena.hpp>
+#include <camoto/gamegraphics/tileset-from_image_list.hpp>
+#include <camoto/gamegraphics/util.hpp>
+#include "../src/tls-jill.hpp"
+
+#include "tests.hpp"
+
+using namespace camoto;
+using namespace camoto::gamegraphics;
+
+/// Arena that passes everything to the heap, but counts what it's given.
+class CountingArena: public PixelArena
+{
+	public:
+		CountingArena()
+			:	numAlloc(0),
+				numFree(0)
+		{
+		}
+
+		virtual void *allocate(std::size_t len)
+		{
+			this->numAlloc++;
+			return ::operator new(len);
+		}
+
+		virtual void deallocate(void *ptr, std::size_t len)
+		{
+			this->numFree++;
+			::operator delete(ptr);
+			return;
+		}
+
+		unsigned int numAlloc;
+		unsigned int numFree;
+};
+
+BOOST_AUTO_TEST_CASE(pixel_arena_scope)
+{
+	BOOST_TEST_MESSAGE("Allocate pixel buffers from an arena");
+
+	CountingArena arena;
+	BOOST_REQUIRE(PixelArena::current() == nullptr);
+	{
+		PixelArenaScope scope(&arena);
+		BOOST_REQUIRE(PixelArena::current() == &arena);
+
+		ArenaPixels pixels(64, 0x00);
+		BOOST_REQUIRE_EQUAL(arena.numAlloc, 1);
+		{
+			PixelArenaScope inner(nullptr);
+			ArenaPixels heap(64, 0x00);
+			BOOST_REQUIRE_EQUAL(arena.numAlloc, 1);
+		}
+		BOOST_REQUIRE(PixelArena::current() == &arena);
+	}
+	BOOST_REQUIRE(PixelArena::current() == nullptr);
+	BOOST_REQUIRE_EQUAL(arena.numFree, 1);
+}
+
+BOOST_AUTO_TEST_CASE(pixel_arena_outlive_scope)
+{
+	BOOST_TEST_MESSAGE("Free arena pixel buffers after leaving the scope");
+
+	CountingArena arena;
+	std::unique_ptr<ArenaPixels> pixels;
+	{
+		PixelArenaScope scope(&arena);
+		pixels.reset(new ArenaPixels(64, 0x00));
+	}
+	BOOST_REQUIRE_EQUAL(arena.numAlloc, 1);
+
+	// A copy made outside the scope must come from the heap
+	ArenaPixels copy = *pixels;
+	BOOST_REQUIRE_EQUAL(arena.numAlloc, 1);
+
+	// The original must still go back to the arena
+	pixels.reset();
+	BOOST_REQUIRE_EQUAL(arena.numFree, 1);
+}
+
+BOOST_AUTO_TEST_CASE(pixel_arena_monotonic)
+{
+	BOOST_TEST_MESSAGE("Allocate from a monotonic arena");
+
+	MonotonicPixelArena arena(256);
+	auto a = static_cast<uint8_t *>(arena.allocate(10));
+	auto b = static_cast<uint8_t *>(arena.allocate(10));
+	BOOST_REQUIRE(a != b);
+	BOOST_REQUIRE_EQUAL((uintptr_t)b % alignof(std::max_align_t), 0);
+
+	// Freeing the most recent allocation allows it to be reused
+	arena.deallocate(b, 10);
+	auto c = static_cast<uint8_t *>(arena.allocate(10));
+	BOOST_REQUIRE(b == c);
+
+	// Allocations larger than a block get one of their own
+	auto big = static_cast<uint8_t *>(arena.allocate(1000));
+	memset(big, 0xFF, 1000);
+	auto d = static_cast<uint8_t *>(arena.allocate(10));
+	BOOST_REQUIRE(d != c);
+	memset(a, 0x00, 10);
+	memset(c, 0x00, 10);
+	memset(d, 0x00, 10);
+}
+
+BOOST_AUTO_TEST_CASE(pixel_arena_long_lived)
+{
+	BOOST_TEST_MESSAGE("Read back image data created inside an arena scope");
+
+	// 8x4 image with two 4x4 tiles, the left half opaque and the right half
+	// transparent
+	Pixels pixOrig(32), maskOrig(32);
+	for (unsigned int i = 0; i < pixOrig.size(); i++) {
+		pixOrig[i] = i % 16;
+		maskOrig[i] = (i % 8 < 4) ? 0x00 : (uint8_t)Image::Mask::Transparent;
+	}
+	auto source = std::make_shared<Image_Memory>(Point{8, 4}, pixOrig, maskOrig,
+		Point{0, 0}, Point{0, 0}, nullptr);
+	auto tileset = make_Tileset_FromImageList(
+		{
+			{
+				source,
+				Tileset_FromImageList::Item::AttachmentType::Append,
+				Tileset_FromImageList::Item::SplitType::UniformTiles,
+				{4, 4},
+				{0, 0, 8, 4},
+				{}
+			}
+		},
+		1
+	);
+	auto jill = std::make_shared<Image_Jill>(Point{8, 4}, Pixels(32), Pixels(32),
+		nullptr, [](){});
+
+	std::unique_ptr<Image> tile, overlay;
+	std::shared_ptr<const ImageSnapshot> snap;
+	{
+		CountingArena arena;
+		PixelArenaScope scope(&arena);
+
+		// Each of these keeps buffers created while the scope is active
+		tile = tileset->openImage(tileset->files()[0]);
+		tile->convert();
+		Pixels pixJill(pixOrig), maskJill(maskOrig);
+		jill->convert(std::move(pixJill), std::move(maskJill));
+		overlay = overlayImage(source.get(), source.get());
+		snap = source->snapshot();
+
+		// Nothing still in use may have come from the arena
+		BOOST_REQUIRE_EQUAL(arena.numAlloc, arena.numFree);
+	}
+
+	Pixels pixTile(16);
+	for (unsigned int i = 0; i < pixTile.size(); i++) {
+		pixTile[i] = pixOrig[(i / 4) * 8 + i % 4];
+	}
+	BOOST_REQUIRE(tile->convert() == pixTile);
+	BOOST_REQUIRE(jill->convert() == pixOrig);
+	BOOST_REQUIRE(jill->convert_mask() == maskOrig);
+	BOOST_REQUIRE(overlay->convert() == pixOrig);
+	BOOST_REQUIRE(overlay->convert_mask() == maskOrig);
+	BOOST_REQUIRE(snap->pixels == pixOrig);
+	BOOST_REQUIRE(snap->mask == maskOrig);
+}
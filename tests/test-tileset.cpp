@@ -54,6 +54,7 @@ void test_tileset::addTests()
 {
 	this->test_archive::addTests();
 	ADD_TILESET_TEST(false, &test_tileset::test_open_image);
+	ADD_TILESET_TEST(false, &test_tileset::test_open_image_async);
 	ADD_TILESET_TEST(false, &test_tileset::test_change_image);
 	return;
 }
@@ -310,6 +311,84 @@ void test_tileset::test_open_image()
 			}
 		}
 	}
+
+	BOOST_TEST_CHECKPOINT("Opening and converting first tile asynchronously");
+	{
+		auto ep = this->findFile(0);
+		auto targetTileset = tileset;
+		if (ep->fAttr & Archive::File::Attribute::Folder) {
+			targetTileset = tileset->openTileset(ep);
+			ep = targetTileset->files().at(0);
+		}
+		QueueExecutor exec;
+		auto futureImg = targetTileset->openImageAsync(ep, exec);
+		BOOST_REQUIRE_EQUAL(exec.runAll(), 1);
+		auto img = futureImg.get();
+		BOOST_REQUIRE(img);
+
+		auto futurePixels = img->convertAsync(exec);
+		BOOST_REQUIRE_EQUAL(exec.runAll(), 1);
+		auto pixels = futurePixels.get();
+		auto pixelsExpected = createTileData(img->dimensions(), this->cga, 0);
+		BOOST_REQUIRE_MESSAGE(
+			this->is_equal(
+				std::string(pixelsExpected.begin(), pixelsExpected.end()),
+				std::string(pixels.begin(), pixels.end())),
+			"Tile #0 converted asynchronously was not standard test image"
+		);
+	}
+}
+
+void test_tileset::test_open_image_async()
+{
+	BOOST_TEST_MESSAGE("Opening and converting two tiles at once");
+
+	auto tileset = std::dynamic_pointer_cast<Tileset>(this->pArchive);
+	BOOST_REQUIRE(tileset);
+
+	// Both tiles share the tileset's stream, so the executor must run the tasks
+	// one at a time.  QueueExecutor does, while still letting both tasks be
+	// outstanding at once so each runs after the other has moved the seek
+	// position.
+	QueueExecutor exec;
+	std::future<std::unique_ptr<Image>> futureImg[2];
+	std::shared_ptr<Tileset> targetTileset[2];
+	for (int i = 0; i < 2; i++) {
+		auto ep = this->findFile(i);
+		targetTileset[i] = tileset;
+		if (ep->fAttr & Archive::File::Attribute::Folder) {
+			targetTileset[i] = tileset->openTileset(ep);
+			ep = targetTileset[i]->files().at(0);
+		}
+		futureImg[i] = targetTileset[i]->openImageAsync(ep, exec);
+	}
+	BOOST_REQUIRE_EQUAL(exec.runAll(), 2);
+
+	std::unique_ptr<Image> img[2];
+	for (int i = 0; i < 2; i++) {
+		img[i] = futureImg[i].get();
+		BOOST_REQUIRE(img[i]);
+	}
+
+	// Convert in the opposite order to make sure neither relies on the other
+	// having left the stream where it expects.
+	std::future<Pixels> futurePixels[2];
+	for (int i = 1; i >= 0; i--) {
+		futurePixels[i] = img[i]->convertAsync(exec);
+	}
+	BOOST_REQUIRE_EQUAL(exec.runAll(), 2);
+
+	for (int i = 0; i < 2; i++) {
+		auto pixels = futurePixels[i].get();
+		auto pixelsExpected = createTileData(img[i]->dimensions(), this->cga, i);
+		BOOST_REQUIRE_MESSAGE(
+			this->is_equal(
+				std::string(pixelsExpected.begin(), pixelsExpected.end()),
+				std::string(pixels.begin(), pixels.end())),
+			createString("Tile #" << i << " converted asynchronously alongside "
+				"another tile was not standard test image")
+		);
+	}
 }
 
 void test_tileset::test_change_image()
@@ -51,6 +51,9 @@ class test_tileset: public test_archive
 		/// Open tiles 1 and 2 and verify content.
 		void test_open_image();
 
+		/// Queue tiles 1 and 2 to be opened and converted at the same time.
+		void test_open_image_async();
+
 		/// Replace tile 1 with tile's 3 content and verify against insert_remove()
 		void test_change_image();
 
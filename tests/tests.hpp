@@ -21,10 +21,12 @@
 #ifndef _CAMOTO_GAMEGRAPHICS_TESTS_HPP_
 #define _CAMOTO_GAMEGRAPHICS_TESTS_HPP_
 
+#include <deque>
 #include <memory>
 #include <boost/test/unit_test.hpp>
 #include <camoto/util.hpp>
 #include <camoto/stream_sub.hpp>
+#include <camoto/gamegraphics/executor.hpp>
 
 /// Allow a string constant to be passed around with embedded nulls
 #define STRING_WITH_NULLS(x)  std::string((x), sizeof((x)) - 1)
@@ -33,6 +35,34 @@
 /// violating unique_ptr requirements.
 std::unique_ptr<camoto::stream::sub> stream_wrap(std::shared_ptr<camoto::stream::inout> base);
 
+/// Executor that holds on to tasks until told to run them, to make sure
+/// asynchronous functions don't depend on their work being done immediately.
+class QueueExecutor: public camoto::gamegraphics::Executor
+{
+	public:
+		virtual void submit(std::function<void()> task)
+		{
+			this->tasks.push_back(task);
+			return;
+		}
+
+		/// Run all the queued tasks, returning how many there were.
+		unsigned int runAll()
+		{
+			unsigned int count = 0;
+			while (!this->tasks.empty()) {
+				auto task = this->tasks.front();
+				this->tasks.pop_front();
+				task();
+				count++;
+			}
+			return count;
+		}
+
+	protected:
+		std::deque<std::function<void()>> tasks;
+};
+
 /// Base class for all tests
 class test_main
 {